@@ -31,10 +31,14 @@
 #include <stdlib.h>
 #endif
 
+#include <pango/pangocairo.h>
+
 #include <terminal/terminal-app.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-gdbus.h>
+#include <terminal/terminal-preferences.h>
 #include <terminal/terminal-preferences-dialog.h>
+#include <terminal/terminal-timer.h>
 
 
 
@@ -167,11 +171,67 @@ usage (void)
 
 
 
+static gpointer
+warm_font_caches (gpointer data)
+{
+  gchar                *font_name = data;
+  PangoFontMap         *font_map;
+  PangoContext         *context;
+  PangoFontDescription *font_desc;
+  PangoFont            *font;
+  PangoFontMetrics     *metrics;
+  PangoLayout          *layout;
+  PangoRectangle        extents;
+#ifdef G_ENABLE_DEBUG
+  gint64                start = g_get_monotonic_time ();
+#endif
+
+  /* fontconfig keeps its configuration, caches and font files process
+   * wide, so matching the font on a private font map here leaves them
+   * warm for the first vte_terminal_set_font() on the main thread */
+  font_map = pango_cairo_font_map_new ();
+  context = pango_font_map_create_context (font_map);
+  font_desc = pango_font_description_from_string (IS_STRING (font_name) ? font_name : "Monospace");
+  pango_context_set_font_description (context, font_desc);
+
+  font = pango_font_map_load_font (font_map, context, font_desc);
+  if (G_LIKELY (font != NULL))
+    {
+      metrics = pango_font_get_metrics (font, NULL);
+      pango_font_metrics_unref (metrics);
+      g_object_unref (font);
+    }
+
+  /* vte measures the cell size with the printable ascii characters */
+  layout = pango_layout_new (context);
+  pango_layout_set_text (layout, " !\"#$%&'()*+,-./0123456789:;<=>?@"
+                                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+                                 "abcdefghijklmnopqrstuvwxyz{|}~", -1);
+  pango_layout_get_pixel_extents (layout, NULL, &extents);
+  g_object_unref (layout);
+
+  pango_font_description_free (font_desc);
+  g_object_unref (context);
+  g_object_unref (font_map);
+  g_free (font_name);
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Warmed font caches in %.1f ms", (g_get_monotonic_time () - start) / 1000.0);
+#endif
+
+  return NULL;
+}
+
+
+
 int
 main (int argc, char **argv)
 {
-  TerminalOptions  options;
-  TerminalApp     *app;
+  TerminalOptions      options;
+  TerminalApp         *app;
+  TerminalPreferences *preferences;
+  gchar               *font_name = NULL;
+  gboolean             font_use_system;
   const gchar     *startup_id;
   const gchar     *display;
   GError          *error = NULL;
@@ -314,6 +374,13 @@ main (int argc, char **argv)
         }
     }
 
+  /* we are the server, load the font while gtk and d-bus initialize */
+  preferences = terminal_preferences_get ();
+  g_object_get (G_OBJECT (preferences), "font-use-system", &font_use_system, NULL);
+  if (!font_use_system)
+    g_object_get (G_OBJECT (preferences), "font-name", &font_name, NULL);
+  g_thread_unref (g_thread_new ("font-warmup", warm_font_caches, font_name));
+
   /* initialize Gtk+ */
   gtk_init (&argc, &argv);
 
@@ -321,6 +388,7 @@ main (int argc, char **argv)
   gtk_window_set_default_icon_name ("org.xfce.terminal");
 
   app = g_object_new (TERMINAL_TYPE_APP, NULL);
+  g_object_unref (G_OBJECT (preferences));
 
   if (!options.disable_server)
     {
@@ -348,5 +416,9 @@ main (int argc, char **argv)
 
   g_object_unref (G_OBJECT (app));
 
+#ifdef G_ENABLE_DEBUG
+  terminal_timer_dump_wakeups ();
+#endif
+
   return EXIT_SUCCESS;
 }
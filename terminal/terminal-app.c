@@ -36,6 +36,7 @@
 #endif
 
 #include <libxfce4ui/libxfce4ui.h>
+#include <xfconf/xfconf.h>
 
 #ifdef GDK_WINDOWING_X11
 #include <X11/Xlib.h>
@@ -46,6 +47,7 @@
 #include <terminal/terminal-config.h>
 #include <terminal/terminal-preferences.h>
 #include <terminal/terminal-private.h>
+#include <terminal/terminal-timer.h>
 #include <terminal/terminal-window.h>
 #include <terminal/terminal-window-dropdown.h>
 
@@ -81,6 +83,7 @@ static void     terminal_app_save_yourself            (XfceSMClient       *clien
                                                        TerminalApp        *app);
 static void     terminal_app_open_window              (TerminalApp        *app,
                                                        TerminalWindowAttr *attr);
+static void     terminal_app_update_system_font       (TerminalApp        *app);
 
 
 
@@ -101,10 +104,21 @@ struct _TerminalApp
   guint                accel_map_save_id;
   GtkAccelMap         *accel_map;
   GSList              *tab_key_accels;
+
+  /* system monospace font, watched once it is used */
+  PangoFontDescription *system_font;
+  XfconfChannel        *xsettings;
+  GSettings            *interface_settings;
+  guint                 system_font_watched : 1;
 };
 
 
 
+/* the screens do not know the app, see terminal_app_get_system_font() */
+static TerminalApp *app_instance = NULL;
+
+
+
 GQuark
 terminal_error_quark (void)
 {
@@ -134,6 +148,8 @@ terminal_app_class_init (TerminalAppClass *klass)
 static void
 terminal_app_init (TerminalApp *app)
 {
+  app_instance = app;
+
   app->preferences = terminal_preferences_get ();
   g_signal_connect_swapped (G_OBJECT (app->preferences), "notify::shortcuts-no-menukey",
                             G_CALLBACK (terminal_app_update_accels), app);
@@ -167,7 +183,7 @@ terminal_app_finalize (GObject *object)
     g_object_unref (G_OBJECT (app->accel_map));
   if (G_UNLIKELY (app->accel_map_save_id != 0))
     {
-      g_source_remove (app->accel_map_save_id);
+      terminal_timer_remove (app->accel_map_save_id);
       terminal_app_accel_map_save (app);
     }
 
@@ -194,6 +210,19 @@ terminal_app_finalize (GObject *object)
     g_free (((TerminalAccel*) lp->data)->path);
   g_slist_free_full (app->tab_key_accels, g_free);
 
+  if (app->xsettings != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (app->xsettings), G_CALLBACK (terminal_app_update_system_font), app);
+      xfconf_shutdown ();
+    }
+  if (app->interface_settings != NULL)
+    g_object_unref (G_OBJECT (app->interface_settings));
+  if (app->system_font != NULL)
+    pango_font_description_free (app->system_font);
+
+  if (app_instance == app)
+    app_instance = NULL;
+
   (*G_OBJECT_CLASS (terminal_app_parent_class)->finalize) (object);
 }
 
@@ -264,6 +293,87 @@ terminal_app_update_windows_accels (gpointer user_data)
 
 
 
+static gchar *
+terminal_app_get_system_font_name (TerminalApp *app)
+{
+  GSettingsSchemaSource *source;
+  GSettingsSchema       *schema;
+  gchar                 *font_name = NULL;
+
+  /* read Xfce settings */
+  if (app->xsettings != NULL
+      && xfconf_channel_has_property (app->xsettings, "/Gtk/MonospaceFontName"))
+    font_name = xfconf_channel_get_string (app->xsettings, "/Gtk/MonospaceFontName", "");
+
+  if (IS_STRING (font_name))
+    return font_name;
+
+  g_free (font_name);
+
+  /* if font isn't set, read GNOME settings, if they are installed */
+  if (app->interface_settings == NULL)
+    {
+      source = g_settings_schema_source_get_default ();
+      schema = source != NULL ? g_settings_schema_source_lookup (source, "org.gnome.desktop.interface", TRUE) : NULL;
+      if (schema == NULL)
+        return NULL;
+
+      if (g_settings_schema_has_key (schema, "monospace-font-name"))
+        {
+          app->interface_settings = g_settings_new_full (schema, NULL, NULL);
+          g_signal_connect_swapped (G_OBJECT (app->interface_settings), "changed::monospace-font-name",
+                                    G_CALLBACK (terminal_app_update_system_font), app);
+        }
+      g_settings_schema_unref (schema);
+
+      if (app->interface_settings == NULL)
+        return NULL;
+    }
+
+  return g_settings_get_string (app->interface_settings, "monospace-font-name");
+}
+
+
+
+static void
+terminal_app_update_system_font (TerminalApp *app)
+{
+  PangoFontDescription *font_desc = NULL;
+  gchar                *font_name;
+  gboolean              font_use_system;
+  GSList               *lp;
+
+  font_name = terminal_app_get_system_font_name (app);
+  if (IS_STRING (font_name))
+    font_desc = pango_font_description_from_string (font_name);
+  g_free (font_name);
+
+  if (app->system_font == NULL && font_desc == NULL)
+    return;
+
+  if (app->system_font != NULL && font_desc != NULL
+      && pango_font_description_equal (app->system_font, font_desc))
+    {
+      pango_font_description_free (font_desc);
+      return;
+    }
+
+  if (app->system_font != NULL)
+    pango_font_description_free (app->system_font);
+  app->system_font = font_desc;
+
+  /* not during the initial lookup */
+  if (!app->system_font_watched)
+    return;
+
+  g_object_get (G_OBJECT (app->preferences), "font-use-system", &font_use_system, NULL);
+  if (font_use_system)
+    for (lp = app->windows; lp != NULL; lp = lp->next)
+      terminal_window_update_font (TERMINAL_WINDOW (lp->data));
+}
+
+
+
 static gboolean
 terminal_app_accel_map_save (gpointer user_data)
 {
@@ -292,12 +402,13 @@ terminal_app_accel_map_changed (TerminalApp *app)
   /* stop pending save */
   if (app->accel_map_save_id != 0)
     {
-      g_source_remove (app->accel_map_save_id);
+      terminal_timer_remove (app->accel_map_save_id);
       app->accel_map_save_id = 0;
     }
 
   /* schedule new save */
-  app->accel_map_save_id = gdk_threads_add_timeout_seconds (10, terminal_app_accel_map_save, app);
+  app->accel_map_save_id = terminal_timer_add (TERMINAL_WAKEUP_ACCEL_MAP_SAVE, 10 * 1000,
+                                               terminal_app_accel_map_save, app, NULL);
 }
 
 
@@ -353,7 +464,10 @@ terminal_app_unset_urgent_bell (TerminalWindow *window,
                                 TerminalApp    *app)
 {
   GtkWidget *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (window));
-  gtk_window_set_urgency_hint (GTK_WINDOW (toplevel), FALSE);
+
+  /* runs for every key release, only talk to the window manager if needed */
+  if (gtk_window_get_urgency_hint (GTK_WINDOW (toplevel)))
+    gtk_window_set_urgency_hint (GTK_WINDOW (toplevel), FALSE);
 
   return FALSE;
 }
@@ -1013,3 +1127,43 @@ terminal_app_process (TerminalApp  *app,
 
   return TRUE;
 }
+
+
+
+/**
+ * terminal_app_get_system_font:
+ *
+ * Returns the monospace font of the desktop settings. The font is looked
+ * up once and updated when the Xfce or GNOME settings change, so screens
+ * can call this for every font update.
+ *
+ * Return value : The system monospace font or %NULL if not set.
+ **/
+const PangoFontDescription *
+terminal_app_get_system_font (void)
+{
+  TerminalApp *app = app_instance;
+  GError      *error = NULL;
+
+  terminal_return_val_if_fail (TERMINAL_IS_APP (app), NULL);
+
+  if (G_UNLIKELY (!app->system_font_watched))
+    {
+      if (xfconf_init (&error))
+        {
+          app->xsettings = xfconf_channel_get ("xsettings");
+          g_signal_connect_swapped (G_OBJECT (app->xsettings), "property-changed::/Gtk/MonospaceFontName",
+                                    G_CALLBACK (terminal_app_update_system_font), app);
+        }
+      else
+        {
+          g_warning ("Failed to connect to xfconf: %s", error->message);
+          g_error_free (error);
+        }
+
+      terminal_app_update_system_font (app);
+      app->system_font_watched = TRUE;
+    }
+
+  return app->system_font;
+}
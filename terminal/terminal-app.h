@@ -59,6 +59,9 @@ gboolean     terminal_app_process             (TerminalApp        *app,
                                                gint                argc,
                                                GError            **error);
 
+const PangoFontDescription *
+             terminal_app_get_system_font     (void);
+
 G_END_DECLS
 
 #endif /* !TERMINAL_APP_H */
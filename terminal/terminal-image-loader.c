@@ -29,26 +29,45 @@
 #define MAX_IMAGE_WIDTH  7680
 #define MAX_IMAGE_HEIGHT 4320
 
-
-
-static void terminal_image_loader_finalize (GObject             *object);
-static void terminal_image_loader_check    (TerminalImageLoader *loader);
-static void terminal_image_loader_tile     (TerminalImageLoader *loader,
-                                            GdkPixbuf           *target,
-                                            gint                 width,
-                                            gint                 height);
-static void terminal_image_loader_center   (TerminalImageLoader *loader,
-                                            GdkPixbuf           *target,
-                                            gint                 width,
-                                            gint                 height);
-static void terminal_image_loader_scale    (TerminalImageLoader *loader,
-                                            GdkPixbuf           *target,
-                                            gint                 width,
-                                            gint                 height);
-static void terminal_image_loader_stretch  (TerminalImageLoader *loader,
-                                            GdkPixbuf           *target,
-                                            gint                 width,
-                                            gint                 height);
+/* rendered sizes kept, for the windows and monitor scales in use */
+#define MAX_CACHED_IMAGES 8
+
+
+
+static void             terminal_image_loader_finalize (GObject             *object);
+static void             terminal_image_loader_check    (TerminalImageLoader *loader);
+static void             terminal_image_loader_tile     (TerminalImageLoader *loader,
+                                                        GdkPixbuf           *target,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        gint                 scale,
+                                                        GdkInterpType        interp);
+static void             terminal_image_loader_center   (TerminalImageLoader *loader,
+                                                        GdkPixbuf           *target,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        gint                 scale,
+                                                        GdkInterpType        interp);
+static void             terminal_image_loader_scale    (TerminalImageLoader *loader,
+                                                        GdkPixbuf           *target,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        GdkInterpType        interp);
+static void             terminal_image_loader_stretch  (TerminalImageLoader *loader,
+                                                        GdkPixbuf           *target,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        GdkInterpType        interp);
+static cairo_surface_t *terminal_image_loader_lookup   (TerminalImageLoader *loader,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        gint                 scale,
+                                                        gboolean             exact);
+static cairo_surface_t *terminal_image_loader_render   (TerminalImageLoader *loader,
+                                                        gint                 width,
+                                                        gint                 height,
+                                                        gint                 scale,
+                                                        GdkInterpType        interp);
 
 
 struct _TerminalImageLoaderClass
@@ -61,10 +80,10 @@ struct _TerminalImageLoader
   GObject                  parent_instance;
   TerminalPreferences     *preferences;
 
-  /* the cached image data */
+  /* the cached image data, surfaces in device pixels, most recently
+   * used first */
   gchar                   *path;
   GSList                  *cache;
-  GSList                  *cache_invalid;
   GdkRGBA                  bgcolor;
   GdkPixbuf               *pixbuf;
   TerminalBackgroundStyle  style;
@@ -100,8 +119,7 @@ terminal_image_loader_finalize (GObject *object)
 {
   TerminalImageLoader *loader = TERMINAL_IMAGE_LOADER (object);
 
-  g_slist_free_full (loader->cache, g_object_unref);
-  g_slist_free_full (loader->cache_invalid, g_object_unref);
+  g_slist_free_full (loader->cache, (GDestroyNotify) cairo_surface_destroy);
 
   g_object_unref (G_OBJECT (loader->preferences));
 
@@ -169,10 +187,10 @@ terminal_image_loader_check (TerminalImageLoader *loader)
       invalidate = TRUE;
     }
 
+  /* surfaces still painted are kept alive by their reference */
   if (invalidate)
     {
-      loader->cache_invalid = g_slist_concat (loader->cache_invalid,
-                                              loader->cache);
+      g_slist_free_full (loader->cache, (GDestroyNotify) cairo_surface_destroy);
       loader->cache = NULL;
     }
 
@@ -186,16 +204,24 @@ static void
 terminal_image_loader_tile (TerminalImageLoader *loader,
                             GdkPixbuf           *target,
                             gint                 width,
-                            gint                 height)
+                            gint                 height,
+                            gint                 scale,
+                            GdkInterpType        interp)
 {
   GdkRectangle area;
+  GdkPixbuf   *source;
   gint         source_width;
   gint         source_height;
   gint         i;
   gint         j;
 
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
+  /* the image pixels are logical pixels, like with the other styles */
+  source_width = gdk_pixbuf_get_width (loader->pixbuf) * scale;
+  source_height = gdk_pixbuf_get_height (loader->pixbuf) * scale;
+  if (scale > 1)
+    source = gdk_pixbuf_scale_simple (loader->pixbuf, source_width, source_height, interp);
+  else
+    source = g_object_ref (G_OBJECT (loader->pixbuf));
 
   for (i = 0; (i * source_width) < width; ++i)
     for (j = 0; (j * source_height) < height; ++j)
@@ -210,10 +236,12 @@ terminal_image_loader_tile (TerminalImageLoader *loader,
         if (area.y + area.height > height)
           area.height = height - area.y;
 
-        gdk_pixbuf_copy_area (loader->pixbuf, 0, 0,
+        gdk_pixbuf_copy_area (source, 0, 0,
                               area.width, area.height,
                               target, area.x, area.y);
       }
+
+  g_object_unref (G_OBJECT (source));
 }
 
 
@@ -222,7 +250,9 @@ static void
 terminal_image_loader_center (TerminalImageLoader *loader,
                               GdkPixbuf           *target,
                               gint                 width,
-                              gint                 height)
+                              gint                 height,
+                              gint                 scale,
+                              GdkInterpType        interp)
 {
   guint32 rgba;
   gint    source_width;
@@ -238,8 +268,9 @@ terminal_image_loader_center (TerminalImageLoader *loader,
         | (((guint)(loader->bgcolor.blue * 65535) & 0xff00) >> 8)) << 8;
   gdk_pixbuf_fill (target, rgba);
 
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
+  /* the image pixels are logical pixels, like with the other styles */
+  source_width = gdk_pixbuf_get_width (loader->pixbuf) * scale;
+  source_height = gdk_pixbuf_get_height (loader->pixbuf) * scale;
 
   dx = MAX ((width - source_width) / 2, 0);
   dy = MAX ((height - source_height) / 2, 0);
@@ -249,8 +280,8 @@ terminal_image_loader_center (TerminalImageLoader *loader,
   gdk_pixbuf_composite (loader->pixbuf, target, dx, dy,
                         MIN (width, source_width),
                         MIN (height, source_height),
-                        x0, y0, 1.0, 1.0,
-                        GDK_INTERP_BILINEAR, 255);
+                        x0, y0, scale, scale,
+                        interp, 255);
 }
 
 
@@ -259,7 +290,8 @@ static void
 terminal_image_loader_scale (TerminalImageLoader *loader,
                              GdkPixbuf           *target,
                              gint                 width,
-                             gint                 height)
+                             gint                 height,
+                             GdkInterpType        interp)
 {
   gdouble xscale;
   gdouble yscale;
@@ -298,7 +330,7 @@ terminal_image_loader_scale (TerminalImageLoader *loader,
                         source_width * xscale,
                         source_height * yscale,
                         x, y, xscale, yscale,
-                        GDK_INTERP_BILINEAR, 255);
+                        interp, 255);
 }
 
 
@@ -307,7 +339,8 @@ static void
 terminal_image_loader_stretch (TerminalImageLoader *loader,
                                GdkPixbuf           *target,
                                gint                 width,
-                               gint                 height)
+                               gint                 height,
+                               GdkInterpType        interp)
 {
   gdouble xscale;
   gdouble yscale;
@@ -323,7 +356,93 @@ terminal_image_loader_stretch (TerminalImageLoader *loader,
   gdk_pixbuf_composite (loader->pixbuf, target,
                         0, 0, width, height,
                         0, 0, xscale, yscale,
-                        GDK_INTERP_BILINEAR, 255);
+                        interp, 255);
+}
+
+
+
+static cairo_surface_t*
+terminal_image_loader_lookup (TerminalImageLoader *loader,
+                              gint                 width,
+                              gint                 height,
+                              gint                 scale,
+                              gboolean             exact)
+{
+  cairo_surface_t *surface;
+  GSList          *lp;
+  gdouble          x_scale, y_scale;
+  gint             w, h;
+
+  for (lp = loader->cache; lp != NULL; lp = lp->next)
+    {
+      surface = lp->data;
+
+      /* surfaces of another monitor scale are kept for when the window moves back */
+      cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+      if ((gint) x_scale != scale)
+        continue;
+
+      w = cairo_image_surface_get_width (surface);
+      h = cairo_image_surface_get_height (surface);
+
+      if ((w == width && h == height) ||
+          (!exact && w >= width && h >= height && loader->style == TERMINAL_BACKGROUND_STYLE_TILED))
+        {
+          /* move to the front */
+          loader->cache = g_slist_delete_link (loader->cache, lp);
+          loader->cache = g_slist_prepend (loader->cache, surface);
+
+          return cairo_surface_reference (surface);
+        }
+    }
+
+  return NULL;
+}
+
+
+
+static cairo_surface_t*
+terminal_image_loader_render (TerminalImageLoader *loader,
+                              gint                 width,
+                              gint                 height,
+                              gint                 scale,
+                              GdkInterpType        interp)
+{
+  cairo_surface_t *surface;
+  GdkPixbuf       *pixbuf;
+
+  pixbuf = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (loader->pixbuf),
+                           gdk_pixbuf_get_has_alpha (loader->pixbuf),
+                           gdk_pixbuf_get_bits_per_sample (loader->pixbuf),
+                           width, height);
+
+  switch (loader->style)
+    {
+    case TERMINAL_BACKGROUND_STYLE_TILED:
+      terminal_image_loader_tile (loader, pixbuf, width, height, scale, interp);
+      break;
+
+    case TERMINAL_BACKGROUND_STYLE_CENTERED:
+      terminal_image_loader_center (loader, pixbuf, width, height, scale, interp);
+      break;
+
+    case TERMINAL_BACKGROUND_STYLE_SCALED:
+      terminal_image_loader_scale (loader, pixbuf, width, height, interp);
+      break;
+
+    case TERMINAL_BACKGROUND_STYLE_STRETCHED:
+      terminal_image_loader_stretch (loader, pixbuf, width, height, interp);
+      break;
+
+    default:
+      terminal_assert_not_reached ();
+    }
+
+  /* the surface keeps the device pixels and draws at logical size */
+  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
+  g_object_unref (G_OBJECT (pixbuf));
+
+  return surface;
 }
 
 
@@ -360,23 +479,31 @@ terminal_image_loader_get (void)
 /**
  * terminal_image_loader_load:
  * @loader      : A #TerminalImageLoader.
- * @width       : The image width.
- * @height      : The image height.
+ * @width       : The image width in logical pixels.
+ * @height      : The image height in logical pixels.
+ * @scale       : The scale factor of the monitor.
+ *
+ * The image is rendered in device pixels and cached per @scale, so
+ * moving a window between monitors with a different scale factor
+ * reuses the variant rendered earlier. Release the returned surface
+ * with cairo_surface_destroy().
  *
  * Return value : The image in the given @width and @height drawn with
  *                the configured style or %NULL on error.
  **/
-GdkPixbuf*
+cairo_surface_t*
 terminal_image_loader_load (TerminalImageLoader *loader,
                             gint                 width,
-                            gint                 height)
+                            gint                 height,
+                            gint                 scale)
 {
-  GdkPixbuf *pixbuf;
-  GSList    *lp;
+  cairo_surface_t *surface;
+  GSList          *lp;
 
   terminal_return_val_if_fail (TERMINAL_IS_IMAGE_LOADER (loader), NULL);
   terminal_return_val_if_fail (width > 0, NULL);
   terminal_return_val_if_fail (height > 0, NULL);
+  terminal_return_val_if_fail (scale > 0, NULL);
 
   terminal_image_loader_check (loader);
 
@@ -384,57 +511,91 @@ terminal_image_loader_load (TerminalImageLoader *loader,
     return NULL;
 
 #ifdef G_ENABLE_DEBUG
-  g_debug ("Image Loader Memory Status: %d images in valid "
-           "cache, %d in invalid cache",
-           g_slist_length (loader->cache),
-           g_slist_length (loader->cache_invalid));
+  g_debug ("Image Loader Memory Status: %d images in cache",
+           g_slist_length (loader->cache));
 #endif
 
   /* check for a cached version */
-  for (lp = loader->cache; lp != NULL; lp = lp->next)
-    {
-      gint w, h;
-      pixbuf = GDK_PIXBUF (lp->data);
-      w = gdk_pixbuf_get_width (pixbuf);
-      h = gdk_pixbuf_get_height (pixbuf);
+  surface = terminal_image_loader_lookup (loader, width * scale, height * scale, scale, FALSE);
+  if (surface != NULL)
+    return surface;
 
-      if ((w == width && h == height) ||
-          (w >= width && h >= height && loader->style == TERMINAL_BACKGROUND_STYLE_TILED))
-        {
-          return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
-        }
+  surface = terminal_image_loader_render (loader, width * scale, height * scale,
+                                          scale, GDK_INTERP_BILINEAR);
+  loader->cache = g_slist_prepend (loader->cache, surface);
+
+  /* drop the least recently used size */
+  lp = g_slist_nth (loader->cache, MAX_CACHED_IMAGES - 1);
+  if (lp != NULL && lp->next != NULL)
+    {
+      g_slist_free_full (lp->next, (GDestroyNotify) cairo_surface_destroy);
+      lp->next = NULL;
     }
 
-  pixbuf = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (loader->pixbuf),
-                           gdk_pixbuf_get_has_alpha (loader->pixbuf),
-                           gdk_pixbuf_get_bits_per_sample (loader->pixbuf),
-                           width, height);
+  return cairo_surface_reference (surface);
+}
 
-  switch (loader->style)
-    {
-    case TERMINAL_BACKGROUND_STYLE_TILED:
-      terminal_image_loader_tile (loader, pixbuf, width, height);
-      break;
 
-    case TERMINAL_BACKGROUND_STYLE_CENTERED:
-      terminal_image_loader_center (loader, pixbuf, width, height);
-      break;
 
-    case TERMINAL_BACKGROUND_STYLE_SCALED:
-      terminal_image_loader_scale (loader, pixbuf, width, height);
-      break;
+/**
+ * terminal_image_loader_load_preview:
+ * @loader      : A #TerminalImageLoader.
+ * @width       : The image width in logical pixels.
+ * @height      : The image height in logical pixels.
+ * @scale       : The scale factor of the monitor.
+ * @x_scale     : Return location for the horizontal paint scale.
+ * @y_scale     : Return location for the vertical paint scale.
+ *
+ * Cheap variant of terminal_image_loader_load() for use while the
+ * terminal is being resized: instead of rendering every intermediate
+ * size, the image cached for the size (or a larger tiled one) is
+ * returned, otherwise the most recently used image of @scale, which
+ * has to be painted scaled by @x_scale and @y_scale to cover the
+ * area. Only without any cached image it is rendered once.
+ *
+ * Return value : The image to paint or %NULL on error.
+ **/
+cairo_surface_t*
+terminal_image_loader_load_preview (TerminalImageLoader *loader,
+                                    gint                 width,
+                                    gint                 height,
+                                    gint                 scale,
+                                    gdouble             *x_scale,
+                                    gdouble             *y_scale)
+{
+  cairo_surface_t *surface;
+  GSList          *lp;
+  gdouble          surface_scale;
 
-    case TERMINAL_BACKGROUND_STYLE_STRETCHED:
-      terminal_image_loader_stretch (loader, pixbuf, width, height);
-      break;
+  terminal_return_val_if_fail (TERMINAL_IS_IMAGE_LOADER (loader), NULL);
+  terminal_return_val_if_fail (width > 0, NULL);
+  terminal_return_val_if_fail (height > 0, NULL);
+  terminal_return_val_if_fail (scale > 0, NULL);
 
-    default:
-      terminal_assert_not_reached ();
-    }
+  *x_scale = *y_scale = 1.0;
 
-  loader->cache = g_slist_prepend (loader->cache, pixbuf);
+  terminal_image_loader_check (loader);
 
-  return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
-}
+  if (G_UNLIKELY (loader->pixbuf == NULL || width <= 1 || height <= 1))
+    return NULL;
+
+  surface = terminal_image_loader_lookup (loader, width * scale, height * scale, scale, FALSE);
+  if (surface != NULL)
+    return surface;
 
+  /* stretch the last image of the previous sizes */
+  for (lp = loader->cache; lp != NULL; lp = lp->next)
+    {
+      surface = lp->data;
+      cairo_surface_get_device_scale (surface, &surface_scale, NULL);
+      if ((gint) surface_scale != scale)
+        continue;
+
+      *x_scale = (gdouble) width * scale / cairo_image_surface_get_width (surface);
+      *y_scale = (gdouble) height * scale / cairo_image_surface_get_height (surface);
 
+      return cairo_surface_reference (surface);
+    }
+
+  return terminal_image_loader_load (loader, width, height, scale);
+}
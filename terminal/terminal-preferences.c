@@ -35,6 +35,7 @@
 #include <terminal/terminal-enum-types.h>
 #include <terminal/terminal-preferences.h>
 #include <terminal/terminal-private.h>
+#include <terminal/terminal-timer.h>
 
 #define TERMINALRC     "xfce4/terminal/terminalrc"
 #define TERMINALRC_OLD "Terminal/terminalrc"
@@ -89,6 +90,8 @@ enum
   PROP_MISC_ALWAYS_SHOW_TABS,
   PROP_MISC_BELL,
   PROP_MISC_BELL_URGENT,
+  PROP_MISC_BELL_BURST,
+  PROP_MISC_BELL_RATE,
   PROP_MISC_BORDERS_DEFAULT,
   PROP_MISC_CURSOR_BLINKS,
   PROP_MISC_CURSOR_SHAPE,
@@ -104,6 +107,10 @@ enum
   PROP_MISC_TAB_CLOSE_MIDDLE_CLICK,
   PROP_MISC_TAB_POSITION,
   PROP_MISC_HIGHLIGHT_URLS,
+  PROP_MISC_HIGHLIGHT_URLS_SINGLE_PASS,
+  PROP_MISC_EDITOR_COMMAND,
+  PROP_MISC_MATCH_RULES,
+  PROP_MISC_MATCH_RULE_LIMIT,
   PROP_MISC_MIDDLE_CLICK_OPENS_URI,
   PROP_MISC_COPY_ON_SELECT,
   PROP_MISC_SHOW_RELAUNCH_DIALOG,
@@ -115,6 +122,7 @@ enum
   PROP_MISC_NEW_TAB_ADJACENT,
   PROP_MISC_SEARCH_DIALOG_OPACITY,
   PROP_MISC_SHOW_UNSAFE_PASTE_DIALOG,
+  PROP_MISC_FLOOD_THRESHOLD,
   PROP_SCROLLING_BAR,
   PROP_SCROLLING_LINES,
   PROP_SCROLLING_ON_OUTPUT,
@@ -838,6 +846,30 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                             FALSE,
                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-bell-burst:
+   *
+   * Number of bells handled in a row before the rate limit applies.
+   **/
+  preferences_props[PROP_MISC_BELL_BURST] =
+      g_param_spec_uint ("misc-bell-burst",
+                         NULL,
+                         "MiscBellBurst",
+                         1, 100, 5,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-bell-rate:
+   *
+   * Number of bells per second handled after a burst.
+   **/
+  preferences_props[PROP_MISC_BELL_RATE] =
+      g_param_spec_uint ("misc-bell-rate",
+                         NULL,
+                         "MiscBellRate",
+                         1, 100, 2,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:misc-borders-default:
    **/
@@ -990,6 +1022,61 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                             TRUE,
                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-highlight-urls-single-pass:
+   *
+   * Match all url patterns with one combined regex instead of one
+   * regex per pattern.
+   **/
+  preferences_props[PROP_MISC_HIGHLIGHT_URLS_SINGLE_PASS] =
+      g_param_spec_boolean ("misc-highlight-urls-single-pass",
+                            NULL,
+                            "MiscHighlightUrlsSinglePass",
+                            FALSE,
+                            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-editor-command:
+   *
+   * Command to open file paths with, "%f" is replaced with the file
+   * and "%l" with the line number. When empty the file is opened with
+   * the default application.
+   **/
+  preferences_props[PROP_MISC_EDITOR_COMMAND] =
+      g_param_spec_string ("misc-editor-command",
+                           NULL,
+                           "MiscEditorCommand",
+                           NULL,
+                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-match-rules:
+   *
+   * Additional clickable patterns, separated by ";" (escaped as "\;"),
+   * each in the form "template|cursor|regex". In the URL template "\0"
+   * is replaced with the match and "\1" etc. with its groups, an empty
+   * cursor name uses the hand cursor.
+   **/
+  preferences_props[PROP_MISC_MATCH_RULES] =
+      g_param_spec_string ("misc-match-rules",
+                           NULL,
+                           "MiscMatchRules",
+                           NULL,
+                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-match-rule-limit:
+   *
+   * PCRE2 match limit of each of the misc-match-rules, rules exceeding
+   * it are disabled.
+   **/
+  preferences_props[PROP_MISC_MATCH_RULE_LIMIT] =
+      g_param_spec_uint ("misc-match-rule-limit",
+                         NULL,
+                         "MiscMatchRuleLimit",
+                         1000, G_MAXUINT, 100000,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:misc-middle-click-open-uri:
    **/
@@ -1080,6 +1167,19 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                             TRUE,
                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-flood-threshold:
+   *
+   * Estimated output rate in KiB/s above which a tab stops updating
+   * its activity color, link cursor and title, 0 to disable.
+   **/
+  preferences_props[PROP_MISC_FLOOD_THRESHOLD] =
+      g_param_spec_uint ("misc-flood-threshold",
+                         NULL,
+                         "MiscFloodThreshold",
+                         0, G_MAXUINT / 1024, 2048,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:scrolling-bar:
    **/
@@ -1253,7 +1353,7 @@ terminal_preferences_dispose (GObject *object)
   /* flush preferences */
   if (G_UNLIKELY (preferences->store_idle_id != 0))
     {
-      g_source_remove (preferences->store_idle_id);
+      terminal_timer_remove (preferences->store_idle_id);
       terminal_preferences_store_idle (preferences);
     }
 
@@ -1506,8 +1606,8 @@ terminal_preferences_schedule_store (TerminalPreferences *preferences)
   if (preferences->store_idle_id == 0 && !preferences->loading_in_progress)
     {
       preferences->store_idle_id =
-          gdk_threads_add_timeout_seconds_full (G_PRIORITY_LOW, 1, terminal_preferences_store_idle,
-                                                preferences, terminal_preferences_store_idle_destroy);
+          terminal_timer_add (TERMINAL_WAKEUP_PREFERENCES_STORE, 1000, terminal_preferences_store_idle,
+                              preferences, terminal_preferences_store_idle_destroy);
     }
 }
 
@@ -1817,3 +1917,43 @@ terminal_preferences_get_color (TerminalPreferences *preferences,
 
   return succeed;
 }
+
+
+
+/**
+ * terminal_preferences_get_background_opaque:
+ * @preferences  : A #TerminalPreferences.
+ * @alpha_return : Return location for the background alpha or %NULL.
+ *
+ * Checks whether the configured background covers the terminal
+ * completely. This is the case for solid backgrounds, but also for
+ * transparent and image backgrounds with a darkness or shading that
+ * rounds to full opacity, where compositing would be wasted.
+ *
+ * Return value : %TRUE if the background is effectively opaque.
+ **/
+gboolean
+terminal_preferences_get_background_opaque (TerminalPreferences *preferences,
+                                            gdouble             *alpha_return)
+{
+  TerminalBackground mode;
+  gdouble            alpha = 1.0;
+
+  terminal_return_val_if_fail (TERMINAL_IS_PREFERENCES (preferences), TRUE);
+
+  g_object_get (G_OBJECT (preferences), "background-mode", &mode, NULL);
+
+  if (G_UNLIKELY (mode == TERMINAL_BACKGROUND_TRANSPARENT))
+    g_object_get (G_OBJECT (preferences), "background-darkness", &alpha, NULL);
+  else if (G_UNLIKELY (mode == TERMINAL_BACKGROUND_IMAGE))
+    g_object_get (G_OBJECT (preferences), "background-image-shading", &alpha, NULL);
+
+  /* anything that ends up as 255 in an 8-bit alpha channel is opaque */
+  if (alpha >= 1.0 - 0.5 / 255.0)
+    alpha = 1.0;
+
+  if (alpha_return != NULL)
+    *alpha_return = alpha;
+
+  return alpha == 1.0;
+}
@@ -95,13 +95,16 @@ typedef enum /*< enum,prefix=TERMINAL_TEXT_BLINK_MODE >*/
   TERMINAL_TEXT_BLINK_MODE_ALWAYS
 } TerminalTextBlinkMode;
 
-GType                terminal_preferences_get_type  (void) G_GNUC_CONST;
+GType                terminal_preferences_get_type              (void) G_GNUC_CONST;
 
-TerminalPreferences *terminal_preferences_get       (void);
+TerminalPreferences *terminal_preferences_get                   (void);
 
-gboolean             terminal_preferences_get_color (TerminalPreferences *preferences,
-                                                     const gchar         *property,
-                                                     GdkRGBA             *color_return);
+gboolean             terminal_preferences_get_color             (TerminalPreferences *preferences,
+                                                                 const gchar         *property,
+                                                                 GdkRGBA             *color_return);
+
+gboolean             terminal_preferences_get_background_opaque (TerminalPreferences *preferences,
+                                                                 gdouble             *alpha_return);
 
 
 G_END_DECLS
@@ -143,13 +143,42 @@
 
 #define DEFS APOS_START_DEF IP_DEF PATH_INNER_DEF PATH_DEF
 
-#define REGEX_URL_AS_IS  DEFS SCHEME "://" USERPASS URL_HOST PORT URLPATH
+#define URL_AS_IS  SCHEME "://" USERPASS URL_HOST PORT URLPATH
 /* TODO: also support file:/etc/passwd */
-#define REGEX_URL_FILE   DEFS "(?ix: file:/ (?: / (?: " HOSTNAME1 " )? / )? (?! / ) )(?&PATH)"
+#define URL_FILE   "(?ix: file:/ (?: / (?: " HOSTNAME1 " )? / )? (?! / ) )(?&PATH)"
 /* Lookbehind so that we don't catch "abc.www.foo.bar", bug 739757. Lookahead for www/ftp for convenience (so that we can reuse HOSTNAME1). */
-#define REGEX_URL_HTTP   DEFS "(?<!(?:" HOSTNAMESEGMENTCHARS_CLASS "|[.]))(?=(?i:www|ftp))" HOSTNAME1 PORT URLPATH
-#define REGEX_URL_VOIP   DEFS "(?i:h323:|sips?:)" USERPASS URL_HOST PORT VOIP_PATH
-#define REGEX_EMAIL      DEFS "(?i:mailto:)?" USER "@" EMAIL_HOST
-#define REGEX_NEWS_MAN   "(?i:news:|man:|info:|magnet:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+"
+#define URL_HTTP   "(?<!(?:" HOSTNAMESEGMENTCHARS_CLASS "|[.]))(?=(?i:www|ftp))" HOSTNAME1 PORT URLPATH
+#define URL_VOIP   "(?i:h323:|sips?:)" USERPASS URL_HOST PORT VOIP_PATH
+/* Lookbehind so that a long run of USERCHARS without a valid host after it is only tried from its start,
+ * not from every character in it, which is quadratic. */
+#define EMAIL      "(?i:mailto:)?(?<![" USERCHARS "])" USER "@" EMAIL_HOST
+#define NEWS_MAN   "(?i:news:|man:|info:|magnet:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+"
+
+/* File paths as printed by compilers and in logs, with an optional line and column, e.g. "src/foo.c:12:5",
+ * "~/.bashrc", "/etc/fstab", "main.c:42". A relative path needs a segment with an extension or a line number,
+ * so "and/or", "TCP/IP" or "10/12/2024" are not taken for one, and a path without a slash needs both. The
+ * lookbehind avoids matching the path of a URL or from within a word, and keeps the lookahead linear. */
+#define FILESEGCHARS_CLASS "[-[:alnum:]_.+@]"
+#define FILESEGTERM_CLASS  "[-[:alnum:]_+@]"
+#define FILE_NOT_AFTER     "(?<! [-[:alnum:]_.+@/~:] )"
+#define FILE_ROOT          "(?x: (?: ~ | \\.\\.? )? / )"
+#define FILE_RELATIVE      "(?x: (?= [-[:alnum:]_.+@/]* (?: \\. [[:alpha:]] | : [0-9] ) ) )"
+#define FILE_LINE_COLUMN   "(?x: : [0-9]+ (?: : [0-9]+ )? )"
+#define FILE_SLASHED       "(?x: (?: " FILE_ROOT " (?: " FILESEGCHARS_CLASS "+ / )* | " FILE_RELATIVE " (?: " FILESEGCHARS_CLASS "+ / )+ ) " FILESEGCHARS_CLASS "* " FILESEGTERM_CLASS " " FILE_LINE_COLUMN "? )"
+#define FILE_BARE          "(?x: " FILESEGCHARS_CLASS "* \\. [[:alnum:]]+ " FILE_LINE_COLUMN " )"
+#define FILE_PATH  "(?x: " FILE_NOT_AFTER " (?: " FILE_SLASHED " | " FILE_BARE " ) )"
+
+#define REGEX_URL_AS_IS  DEFS URL_AS_IS
+#define REGEX_URL_FILE   DEFS URL_FILE
+#define REGEX_URL_HTTP   DEFS URL_HTTP
+#define REGEX_URL_VOIP   DEFS URL_VOIP
+#define REGEX_EMAIL      DEFS EMAIL
+#define REGEX_NEWS_MAN   NEWS_MAN
+#define REGEX_FILE_PATH  FILE_PATH
+
+/* The above in a single alternation sharing one DEFS prelude, so the text is scanned once.
+ * The named group that participated in the match tells which one it was. Not in free-spacing
+ * mode, as the fragments contain literal spaces and '#'. */
+#define REGEX_URL_ANY    DEFS "(?:(?<URL_AS_IS>" URL_AS_IS ")|(?<URL_HTTP>" URL_HTTP ")|(?<URL_FILE>" URL_FILE ")|(?<EMAIL>" EMAIL ")|(?<NEWS_MAN>" NEWS_MAN ")|(?<FILE_PATH>" FILE_PATH "))"
 
 #endif /* !TERMINAL_REGEX_H */
@@ -34,23 +34,27 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
-#ifdef HAVE_TIME_H
-#include <time.h>
-#endif
 #ifdef HAVE_LIBUTEMPTER
 #include <utempter.h>
 #endif
 
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <glib-unix.h>
 
 #include <libxfce4ui/libxfce4ui.h>
-#include <xfconf/xfconf.h>
 
 #include <terminal/terminal-util.h>
+#include <terminal/terminal-app.h>
 #include <terminal/terminal-enum-types.h>
 #include <terminal/terminal-image-loader.h>
 #include <terminal/terminal-marshal.h>
 #include <terminal/terminal-screen.h>
+#include <terminal/terminal-search.h>
+#include <terminal/terminal-timer.h>
 #include <terminal/terminal-widget.h>
 #include <terminal/terminal-window.h>
 
@@ -69,13 +73,56 @@
 #define MIN_COLUMNS 4
 #define MIN_ROWS    1
 
+/* title changes of a visible screen are coalesced to one update per
+ * frame, a hidden screen only shows its title in the tab label */
+#define HIDDEN_TITLE_UPDATE_INTERVAL 250
+
+/* interval of the tab activity label updates */
+#define ACTIVITY_INTERVAL 250
+
+/* quiet period after the last resize before the background image is
+ * rendered in full quality */
+#define BACKGROUND_SETTLE_TIMEOUT 250
+
+/* time callers of terminal_screen_get_working_directory() wait for
+ * procfs before the cached directory is used */
+#define CWD_LOOKUP_TIMEOUT 50
+
+/* delay between output and the foreground process lookup */
+#define FOREGROUND_CHECK_INTERVAL TERMINAL_TIMER_TICK
+
+/* interval of the output rate samples */
+#define THROUGHPUT_INTERVAL 1000
+
+/* delay of updating the search matches after output */
+#define SEARCH_UPDATE_INTERVAL 500
+
+/* make sure that we use linprocfs on all systems */
+#if defined(__FreeBSD__)
+#define PROC_PREFIX "/compat/linux/proc"
+#elif defined(__NetBSD__) || defined(__OpenBSD__)
+#define PROC_PREFIX "/emul/linux/proc"
+#else
+#define PROC_PREFIX "/proc"
+#endif
+
 
 
 enum
 {
   PROP_0,
   PROP_CUSTOM_TITLE,
-  PROP_TITLE
+  PROP_TITLE,
+  PROP_PROCESS_ID,
+  PROP_PROCESS_NAME,
+  PROP_WORKING_DIRECTORY,
+  PROP_OUTPUT_EVENTS,
+  PROP_ROWS_SCROLLED,
+  PROP_OUTPUT_RATE,
+  PROP_FLOODING,
+  PROP_BELLS_SUPPRESSED,
+  PROP_SEARCH_MATCHES,
+  PROP_SEARCH_MATCH
 };
 
 enum
@@ -96,6 +143,26 @@ enum
 
 
 
+/* procfs lookup of the working directory, shared with the worker */
+typedef struct
+{
+  gint            ref_count;
+
+  /* only used on the main thread, cleared when the result is stale */
+  TerminalScreen *screen;
+  GPid            pgrp;
+
+  gchar          *path;
+
+  /* protected by the mutex until done is set */
+  GMutex          mutex;
+  GCond           cond;
+  gchar          *result;
+  guint           done : 1;
+} TerminalCwdLookup;
+
+
+
 static void       terminal_screen_finalize                      (GObject               *object);
 static void       terminal_screen_get_property                  (GObject               *object,
                                                                  guint                  prop_id,
@@ -143,18 +210,58 @@ static void       terminal_screen_vte_child_exited              (VteTerminal
                                                                  TerminalScreen        *screen);
 static void       terminal_screen_vte_eof                       (VteTerminal           *terminal,
                                                                  TerminalScreen        *screen);
+static void       terminal_screen_drop_progress                 (TerminalWidget        *widget,
+                                                                 guint64                written,
+                                                                 guint64                total,
+                                                                 TerminalScreen        *screen);
+static gboolean   terminal_screen_search_draw                   (GtkWidget             *area,
+                                                                 cairo_t               *cr,
+                                                                 TerminalScreen        *screen);
+static void       terminal_screen_search_scanned                (const TerminalSearchMatch *matches,
+                                                                 guint                  n_matches,
+                                                                 gboolean               finished,
+                                                                 gpointer               user_data);
+static gboolean   terminal_screen_search_update                 (gpointer               user_data);
+static void       terminal_screen_search_queue_update           (TerminalScreen        *screen);
 static GtkWidget *terminal_screen_vte_get_context_menu          (TerminalWidget        *widget,
                                                                  TerminalScreen        *screen);
 static void       terminal_screen_vte_selection_changed         (VteTerminal           *terminal,
                                                                  TerminalScreen        *screen);
 static void       terminal_screen_vte_window_title_changed      (VteTerminal           *terminal,
                                                                  TerminalScreen        *screen);
+static void       terminal_screen_vte_directory_changed         (VteTerminal           *terminal,
+                                                                 TerminalScreen        *screen);
+static GPid       terminal_screen_get_foreground_pgrp           (TerminalScreen        *screen);
+static const gchar *
+                  terminal_screen_update_working_directory      (TerminalScreen        *screen,
+                                                                 gboolean               wait);
+static gpointer   terminal_cwd_lookup_thread                    (gpointer               data);
+static gboolean   terminal_cwd_lookup_finished                  (gpointer               data);
+static void       terminal_cwd_lookup_unref                     (TerminalCwdLookup     *lookup);
+static void       terminal_screen_apply_cwd                     (TerminalScreen        *screen,
+                                                                 TerminalCwdLookup     *lookup);
+static void       terminal_screen_invalidate_cwd                (TerminalScreen        *screen);
+static void       terminal_screen_set_foreground                (TerminalScreen        *screen,
+                                                                 GPid                   pgrp);
+static void       terminal_screen_unwatch_foreground            (TerminalScreen        *screen);
+static gboolean   terminal_screen_query_tooltip                 (GtkWidget             *widget,
+                                                                 gint                   x,
+                                                                 gint                   y,
+                                                                 gboolean               keyboard_mode,
+                                                                 GtkTooltip            *tooltip,
+                                                                 TerminalScreen        *screen);
+static void       terminal_screen_record_activity               (TerminalScreen        *screen);
+static void       terminal_screen_queue_title_update            (TerminalScreen        *screen);
 static void       terminal_screen_vte_resize_window             (VteTerminal           *terminal,
                                                                  guint                  width,
                                                                  guint                  height,
                                                                  TerminalScreen        *screen);
 static void       terminal_screen_vte_window_contents_changed   (TerminalScreen        *screen);
+static void       terminal_screen_untrack_activity              (TerminalScreen        *screen);
 static void       terminal_screen_vte_window_contents_resized   (TerminalScreen        *screen);
+static void       terminal_screen_vte_size_allocate             (GtkWidget             *widget,
+                                                                 GtkAllocation         *allocation,
+                                                                 TerminalScreen        *screen);
 static void       terminal_screen_update_label_orientation      (TerminalScreen        *screen);
 static void       terminal_screen_urgent_bell                   (TerminalWidget        *widget,
                                                                  TerminalScreen        *screen);
@@ -184,6 +291,7 @@ struct _TerminalScreen
   GtkWidget           *terminal;
   GtkWidget           *scrollbar;
   GtkWidget           *tab_label;
+  GtkWidget           *drop_progress;
 
   GdkRGBA              background_color;
 
@@ -192,10 +300,51 @@ struct _TerminalScreen
   GPid                 pid;
   gchar               *working_directory;
 
+  /* the cached working directory is valid for this foreground
+   * process group until it changes or the shell sends OSC 7 */
+  GPid                 cwd_pgrp;
+  guint                cwd_valid : 1;
+  TerminalCwdLookup   *cwd_lookup;
+
+  /* foreground process group of the pty, only updated after
+   * output or when the process exits */
+  GPid                 fg_pid;
+  gchar               *fg_name;
+  guint                fg_check_id;
+  guint                fg_watch_id;
+  gint                 fg_pidfd;
+
+  /* output statistics, the rate is sampled while there is output */
+  guint64              output_events;
+  guint64              rows_scrolled;
+  guint                output_rate;
+  guint64              sample_events;
+  glong                sample_row;
+  gint64               sample_time;
+  guint                sample_id;
+
+  /* the output rate is above misc-flood-threshold */
+  guint                flooding : 1;
+  guint                title_pending : 1;
+
+  /* token bucket limiting the bell handling */
+  gdouble              bell_tokens;
+  gint64               bell_time;
+  guint                bell_burst;
+  guint                bell_rate;
+  guint                bells_suppressed;
+  guint                bell_audible : 1;
+  guint                bell_urgent : 1;
+
   gchar              **custom_command;
   gchar               *custom_title;
   gchar               *initial_title;
 
+  /* last notified title and pending title update */
+  gchar               *title;
+  guint                title_tick_id;
+  guint                title_timer_id;
+
   gchar               *custom_fg_color;
   gchar               *custom_bg_color;
   gchar               *custom_title_color;
@@ -203,18 +352,54 @@ struct _TerminalScreen
   TerminalTitle        dynamic_title_mode;
   guint                hold : 1;
   guint                has_random_bg_color : 1;
-#if !VTE_CHECK_VERSION (0, 51, 1)
+  guint                background_opaque : 1;
   guint                scroll_on_output : 1;
-#endif
 
-  guint                activity_timeout_id;
-  time_t               activity_resize_time;
+  /* not the visible page or the window is iconified */
+  guint                hidden : 1;
+
+  /* font or zoom changed while hidden */
+  guint                font_dirty : 1;
+
+  /* monotonic times of the last output and resize */
+  gint64               activity_time;
+  gint64               activity_resize_time;
+  guint                activity_tracked : 1;
+  guint                activity_shown : 1;
+
+  /* background image resize mode */
+  guint                background_settle_id;
+  gint                 background_width;
+  gint                 background_height;
+
+  /* index of the search matches in a ring buffer, sorted from the
+   * head, so chunks above the origin are added in front and rows that
+   * left the scrollback are dropped without moving the others; rows
+   * before search_indexed are final */
+  GRegex              *search_regex;
+  TerminalSearchScan  *search_scan;
+  TerminalSearchMatch *search_matches;
+  guint                search_size;
+  guint                search_head;
+  guint                search_len;
+  glong                search_origin;
+  glong                search_indexed;
+  guint                search_update_id;
+  TerminalSearchMatch  search_current;
+  GtkWidget           *search_highlight;
+  guint                search_has_current : 1;
+  guint                search_jumped : 1;
+  guint                search_dirty : 1;
 };
 
 
 
-static guint screen_signals[LAST_SIGNAL];
-static guint screen_last_session_id = 0;
+static guint   screen_signals[LAST_SIGNAL];
+static guint   screen_last_session_id = 0;
+
+/* screens with a pending tab activity update */
+static GSList *screen_activity_list = NULL;
+static guint   screen_activity_timer_id = 0;
 
 
 
@@ -260,6 +445,130 @@ terminal_screen_class_init (TerminalScreenClass *klass)
                                                         NULL,
                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * TerminalScreen:process-id:
+   *
+   * Process group in the foreground of the terminal or -1.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_PROCESS_ID,
+                                   g_param_spec_int ("process-id",
+                                                     "process-id",
+                                                     "process-id",
+                                                     -1, G_MAXINT, -1,
+                                                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:process-name:
+   *
+   * Name of the foreground process or %NULL.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_PROCESS_NAME,
+                                   g_param_spec_string ("process-name",
+                                                        "process-name",
+                                                        "process-name",
+                                                        NULL,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:working-directory:
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_WORKING_DIRECTORY,
+                                   g_param_spec_string ("working-directory",
+                                                        "working-directory",
+                                                        "working-directory",
+                                                        NULL,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:output-events:
+   *
+   * Number of contents changes reported by the terminal.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_OUTPUT_EVENTS,
+                                   g_param_spec_uint64 ("output-events",
+                                                        "output-events",
+                                                        "output-events",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:rows-scrolled:
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_ROWS_SCROLLED,
+                                   g_param_spec_uint64 ("rows-scrolled",
+                                                        "rows-scrolled",
+                                                        "rows-scrolled",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:output-rate:
+   *
+   * Output in bytes per second, estimated from the scrolled rows.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_OUTPUT_RATE,
+                                   g_param_spec_uint ("output-rate",
+                                                      "output-rate",
+                                                      "output-rate",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:flooding:
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_FLOODING,
+                                   g_param_spec_boolean ("flooding",
+                                                         "flooding",
+                                                         "flooding",
+                                                         FALSE,
+                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:bells-suppressed:
+   *
+   * Number of bells dropped by the rate limit, this is not notified.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_BELLS_SUPPRESSED,
+                                   g_param_spec_uint ("bells-suppressed",
+                                                      "bells-suppressed",
+                                                      "bells-suppressed",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:search-matches:
+   *
+   * Number of search matches indexed so far.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_SEARCH_MATCHES,
+                                   g_param_spec_uint ("search-matches",
+                                                      "search-matches",
+                                                      "search-matches",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * TerminalScreen:search-match:
+   *
+   * Position of the current search match starting at 1, 0 if unknown.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_SEARCH_MATCH,
+                                   g_param_spec_uint ("search-match",
+                                                      "search-match",
+                                                      "search-match",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /**
    * TerminalScreen::get-context-menu
    **/
@@ -304,6 +613,8 @@ terminal_screen_init (TerminalScreen *screen)
   screen->dynamic_title_mode = TERMINAL_TITLE_DEFAULT;
   screen->session_id = ++screen_last_session_id;
   screen->pid = -1;
+  screen->fg_pid = -1;
+  screen->fg_pidfd = -1;
 
   screen->hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
   gtk_container_add (GTK_CONTAINER (screen), screen->hbox);
@@ -319,12 +630,18 @@ terminal_screen_init (TerminalScreen *screen)
       G_CALLBACK (terminal_screen_vte_selection_changed), screen);
   g_signal_connect (G_OBJECT (screen->terminal), "window-title-changed",
       G_CALLBACK (terminal_screen_vte_window_title_changed), screen);
+  g_signal_connect (G_OBJECT (screen->terminal), "current-directory-uri-changed",
+      G_CALLBACK (terminal_screen_vte_directory_changed), screen);
   g_signal_connect (G_OBJECT (screen->terminal), "resize-window",
       G_CALLBACK (terminal_screen_vte_resize_window), screen);
   g_signal_connect (G_OBJECT (screen->terminal), "draw",
       G_CALLBACK (terminal_screen_draw), screen);
+  g_signal_connect (G_OBJECT (screen->terminal), "bell",
+      G_CALLBACK (terminal_screen_urgent_bell), screen);
   g_signal_connect_swapped (G_OBJECT (screen->terminal), "paste-selection-request",
       G_CALLBACK (terminal_screen_paste_primary), screen);
+  g_signal_connect (G_OBJECT (screen->terminal), "drop-progress",
+      G_CALLBACK (terminal_screen_drop_progress), screen);
   gtk_box_pack_start (GTK_BOX (screen->hbox), screen->terminal, TRUE, TRUE, 0);
 
   screen->scrollbar = gtk_scrollbar_new (GTK_ORIENTATION_VERTICAL,
@@ -365,6 +682,8 @@ terminal_screen_init (TerminalScreen *screen)
       G_CALLBACK (terminal_screen_vte_window_contents_changed), screen);
   g_signal_connect_swapped (G_OBJECT (screen->terminal), "size-allocate",
       G_CALLBACK (terminal_screen_vte_window_contents_resized), screen);
+  g_signal_connect (G_OBJECT (screen->terminal), "size-allocate",
+      G_CALLBACK (terminal_screen_vte_size_allocate), screen);
 }
 
 
@@ -374,8 +693,32 @@ terminal_screen_finalize (GObject *object)
 {
   TerminalScreen *screen = TERMINAL_SCREEN (object);
 
-  if (screen->activity_timeout_id != 0)
-    g_source_remove (screen->activity_timeout_id);
+  terminal_screen_untrack_activity (screen);
+
+  if (screen->search_scan != NULL)
+    terminal_search_scan_cancel (screen->search_scan);
+  if (screen->search_update_id != 0)
+    terminal_timer_remove (screen->search_update_id);
+  if (screen->search_regex != NULL)
+    g_regex_unref (screen->search_regex);
+  g_free (screen->search_matches);
+
+  if (screen->background_settle_id != 0)
+    terminal_timer_remove (screen->background_settle_id);
+
+  if (screen->title_timer_id != 0)
+    terminal_timer_remove (screen->title_timer_id);
+
+  if (screen->fg_check_id != 0)
+    terminal_timer_remove (screen->fg_check_id);
+  terminal_screen_unwatch_foreground (screen);
+
+  if (screen->sample_id != 0)
+    terminal_timer_remove (screen->sample_id);
+  g_free (screen->fg_name);
+
+  /* a worker still blocked in readlink() releases it */
+  terminal_screen_invalidate_cwd (screen);
 
   /* detach from preferences */
   g_signal_handlers_disconnect_by_func (screen->preferences,
@@ -389,6 +732,7 @@ terminal_screen_finalize (GObject *object)
   g_free (screen->working_directory);
   g_free (screen->custom_title);
   g_free (screen->initial_title);
+  g_free (screen->title);
   g_free (screen->custom_fg_color);
   g_free (screen->custom_bg_color);
   g_free (screen->custom_title_color);
@@ -408,6 +752,7 @@ terminal_screen_get_property (GObject    *object,
   const gchar    *title = NULL;
   TerminalTitle   mode;
   gchar          *initial;
+  guint           current, total;
   gchar          *parsed_title = NULL;
   gchar          *custom_title;
 
@@ -421,7 +766,9 @@ terminal_screen_get_property (GObject    *object,
       break;
 
     case PROP_TITLE:
-      if (G_UNLIKELY (screen->custom_title != NULL))
+      if (G_LIKELY (screen->title != NULL))
+        g_value_set_string (value, screen->title);
+      else if (G_UNLIKELY (screen->custom_title != NULL))
         {
           custom_title = terminal_screen_parse_title (screen, screen->custom_title);
           g_value_take_string (value, custom_title);
@@ -460,6 +807,44 @@ terminal_screen_get_property (GObject    *object,
         }
       break;
 
+    case PROP_PROCESS_ID:
+      g_value_set_int (value, screen->fg_pid);
+      break;
+
+    case PROP_PROCESS_NAME:
+      g_value_set_string (value, screen->fg_name);
+      break;
+
+    case PROP_WORKING_DIRECTORY:
+      g_value_set_string (value, terminal_screen_update_working_directory (screen, FALSE));
+      break;
+
+    case PROP_OUTPUT_EVENTS:
+      g_value_set_uint64 (value, screen->output_events);
+      break;
+
+    case PROP_ROWS_SCROLLED:
+      g_value_set_uint64 (value, screen->rows_scrolled);
+      break;
+
+    case PROP_OUTPUT_RATE:
+      g_value_set_uint (value, screen->output_rate);
+      break;
+
+    case PROP_FLOODING:
+      g_value_set_boolean (value, screen->flooding);
+      break;
+
+    case PROP_BELLS_SUPPRESSED:
+      g_value_set_uint (value, screen->bells_suppressed);
+      break;
+
+    case PROP_SEARCH_MATCHES:
+    case PROP_SEARCH_MATCH:
+      terminal_screen_search_get_matches (screen, &current, &total);
+      g_value_set_uint (value, prop_id == PROP_SEARCH_MATCH ? current : total);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -539,14 +924,20 @@ terminal_screen_draw (GtkWidget *widget,
 {
   TerminalScreen     *screen = TERMINAL_SCREEN (user_data);
   TerminalBackground  background_mode;
-  GdkPixbuf          *image;
+  cairo_surface_t    *image;
   gint                width, height;
+  gint                scale;
+  gdouble             x_scale = 1.0, y_scale = 1.0;
   cairo_surface_t    *surface;
   cairo_t            *ctx;
 
   terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
   terminal_return_val_if_fail (VTE_IS_TERMINAL (screen->terminal), FALSE);
 
+  /* the image is completely covered by the background color */
+  if (G_LIKELY (screen->background_opaque))
+    return FALSE;
+
   g_object_get (G_OBJECT (screen->preferences), "background-mode", &background_mode, NULL);
 
   if (G_LIKELY (background_mode != TERMINAL_BACKGROUND_IMAGE))
@@ -554,10 +945,17 @@ terminal_screen_draw (GtkWidget *widget,
 
   width = gtk_widget_get_allocated_width (screen->terminal);
   height = gtk_widget_get_allocated_height (screen->terminal);
+  scale = gtk_widget_get_scale_factor (screen->terminal);
 
   if (screen->loader == NULL)
     screen->loader = terminal_image_loader_get ();
-  image = terminal_image_loader_load (screen->loader, width, height);
+
+  /* stretch an image of an earlier size while the size is still changing */
+  if (G_UNLIKELY (screen->background_settle_id != 0))
+    image = terminal_image_loader_load_preview (screen->loader, width, height, scale,
+                                                &x_scale, &y_scale);
+  else
+    image = terminal_image_loader_load (screen->loader, width, height, scale);
 
   if (G_UNLIKELY (image == NULL))
     return FALSE;
@@ -568,13 +966,19 @@ terminal_screen_draw (GtkWidget *widget,
   cairo_save (cr);
 
   /* draw background image; cairo_set_operator() allows PNG transparency */
-  gdk_cairo_set_source_pixbuf (cr, image, 0, 0);
+  cairo_save (cr);
+  cairo_scale (cr, x_scale, y_scale);
+  cairo_set_source_surface (cr, image, 0, 0);
+  if (x_scale != 1.0 || y_scale != 1.0)
+    cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_FAST);
   cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
   cairo_paint (cr);
-  g_object_unref (G_OBJECT (image));
+  cairo_restore (cr);
+  cairo_surface_destroy (image);
 
-  /* draw vte terminal */
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  /* draw vte terminal, in device pixels */
+  surface = gdk_window_create_similar_image_surface (gtk_widget_get_window (screen->terminal),
+                                                     CAIRO_FORMAT_ARGB32, width, height, scale);
   ctx = cairo_create (surface);
   gtk_widget_draw (screen->terminal, ctx);
   cairo_set_source_surface (cr, surface, 0, 0);
@@ -810,7 +1214,7 @@ terminal_screen_parse_title (TerminalScreen *screen,
         case 'd':
         case 'D':
           if (directory == NULL)
-            directory = terminal_screen_get_working_directory (screen);
+            directory = terminal_screen_update_working_directory (screen, FALSE);
 
           if (G_LIKELY (directory != NULL))
             {
@@ -837,6 +1241,12 @@ terminal_screen_parse_title (TerminalScreen *screen,
           g_string_append (string, vte_title);
           break;
 
+        case 'p':
+          /* name of the foreground process */
+          if (G_LIKELY (screen->fg_name != NULL))
+            g_string_append (string, screen->fg_name);
+          break;
+
         default:
           g_string_append_c (string, '%');
           continue;
@@ -922,20 +1332,23 @@ terminal_screen_get_child_environment (TerminalScreen *screen)
 static void
 terminal_screen_update_background (TerminalScreen *screen)
 {
-  TerminalBackground background_mode;
-  gdouble            background_alpha;
+  gdouble  background_alpha;
+  gboolean opaque;
 
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
   terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
 
-  g_object_get (G_OBJECT (screen->preferences), "background-mode", &background_mode, NULL);
-
-  if (G_UNLIKELY (background_mode == TERMINAL_BACKGROUND_TRANSPARENT))
-    g_object_get (G_OBJECT (screen->preferences), "background-darkness", &background_alpha, NULL);
-  else if (G_UNLIKELY (background_mode == TERMINAL_BACKGROUND_IMAGE))
-    g_object_get (G_OBJECT (screen->preferences), "background-image-shading", &background_alpha, NULL);
-  else
-    background_alpha = 1.0;
+  /* an opaque background lets vte draw directly, without the offscreen
+   * image compositing in terminal_screen_draw() */
+  opaque = terminal_preferences_get_background_opaque (screen->preferences, &background_alpha);
+  if (screen->background_opaque != opaque)
+    {
+      screen->background_opaque = opaque;
+#ifdef G_ENABLE_DEBUG
+      g_debug ("Screen %u uses the %s background path",
+               screen->session_id, opaque ? "direct" : "composited");
+#endif
+    }
 
   screen->background_color.alpha = background_alpha;
   vte_terminal_set_color_background (VTE_TERMINAL (screen->terminal), &screen->background_color);
@@ -1214,10 +1627,26 @@ terminal_screen_update_colors (TerminalScreen *screen)
 static void
 terminal_screen_update_misc_bell (TerminalScreen *screen)
 {
-  gboolean bval;
-  g_object_get (G_OBJECT (screen->preferences), "misc-bell", &bval, NULL);
-  vte_terminal_set_audible_bell (VTE_TERMINAL (screen->terminal), bval);
-  g_signal_connect (screen->terminal, "bell", G_CALLBACK (terminal_screen_urgent_bell), screen);
+  gboolean audible, urgent;
+
+  g_object_get (G_OBJECT (screen->preferences),
+                "misc-bell", &audible,
+                "misc-bell-urgent", &urgent,
+                "misc-bell-burst", &screen->bell_burst,
+                "misc-bell-rate", &screen->bell_rate,
+                NULL);
+
+  /* the bell is rate limited in terminal_screen_urgent_bell(), so
+   * vte must not beep on its own */
+  vte_terminal_set_audible_bell (VTE_TERMINAL (screen->terminal), FALSE);
+  screen->bell_audible = audible;
+  screen->bell_urgent = urgent;
+
+  /* start with a full bucket */
+  if (screen->bell_time == 0)
+    screen->bell_tokens = screen->bell_burst;
+  else
+    screen->bell_tokens = MIN (screen->bell_tokens, screen->bell_burst);
 }
 
 
@@ -1227,6 +1656,11 @@ terminal_screen_update_misc_cursor_blinks (TerminalScreen *screen)
 {
   gboolean bval;
   g_object_get (G_OBJECT (screen->preferences), "misc-cursor-blinks", &bval, NULL);
+
+  /* nobody sees the cursor of a hidden screen */
+  if (G_UNLIKELY (screen->hidden))
+    bval = FALSE;
+
   vte_terminal_set_cursor_blink_mode (VTE_TERMINAL (screen->terminal),
                                       bval ? VTE_CURSOR_BLINK_ON : VTE_CURSOR_BLINK_OFF);
 }
@@ -1349,6 +1783,9 @@ terminal_screen_update_text_blink_mode (TerminalScreen *screen)
         terminal_assert_not_reached ();
     }
 
+  if (G_UNLIKELY (screen->hidden))
+    mode = VTE_TEXT_BLINK_NEVER;
+
   vte_terminal_set_text_blink_mode (VTE_TERMINAL (screen->terminal), mode);
 #endif
 }
@@ -1358,6 +1795,11 @@ terminal_screen_update_text_blink_mode (TerminalScreen *screen)
 static void
 terminal_screen_update_title (TerminalScreen *screen)
 {
+  /* drop the cached title, the window title might change even if
+   * the tab title does not */
+  g_free (screen->title);
+  screen->title = NULL;
+
   g_object_notify (G_OBJECT (screen), "title");
 }
 
@@ -1418,6 +1860,8 @@ terminal_screen_vte_child_exited (VteTerminal    *terminal,
   terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
+  terminal_screen_set_foreground (screen, -1);
+
   g_object_get (G_OBJECT (screen->preferences), "misc-show-relaunch-dialog", &show_relaunch_dialog, NULL);
 
   if (G_LIKELY (!screen->hold))
@@ -1471,6 +1915,51 @@ terminal_screen_vte_eof (VteTerminal    *terminal,
 
 
 
+static void
+terminal_screen_drop_progress (TerminalWidget *widget,
+                               guint64         written,
+                               guint64         total,
+                               TerminalScreen *screen)
+{
+  gchar *written_str;
+  gchar *total_str;
+  gchar *text;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (written >= total)
+    {
+      if (screen->drop_progress != NULL)
+        {
+          gtk_widget_destroy (screen->drop_progress);
+          screen->drop_progress = NULL;
+        }
+      return;
+    }
+
+  if (screen->drop_progress == NULL)
+    {
+      screen->drop_progress = gtk_progress_bar_new ();
+      gtk_progress_bar_set_show_text (GTK_PROGRESS_BAR (screen->drop_progress), TRUE);
+      gtk_widget_set_halign (screen->drop_progress, GTK_ALIGN_FILL);
+      gtk_widget_set_valign (screen->drop_progress, GTK_ALIGN_END);
+      gtk_overlay_add_overlay (GTK_OVERLAY (screen), screen->drop_progress);
+      gtk_widget_show (screen->drop_progress);
+    }
+
+  written_str = g_format_size (written);
+  total_str = g_format_size (total);
+  /* I18N: progress of writing dropped data to the terminal */
+  text = g_strdup_printf (_("Pasting %s of %s"), written_str, total_str);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (screen->drop_progress), text);
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (screen->drop_progress), (gdouble) written / total);
+  g_free (written_str);
+  g_free (total_str);
+  g_free (text);
+}
+
+
+
 static GtkWidget*
 terminal_screen_vte_get_context_menu (TerminalWidget  *widget,
                                       TerminalScreen  *screen)
@@ -1503,1234 +1992,2680 @@ terminal_screen_vte_selection_changed (VteTerminal    *terminal,
 
 
 static void
-terminal_screen_vte_window_title_changed (VteTerminal    *terminal,
-                                          TerminalScreen *screen)
+terminal_screen_title_update (TerminalScreen *screen)
 {
-  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  gchar *old_title;
+
+  /* compute the new title, bypassing the cache */
+  old_title = screen->title;
+  screen->title = NULL;
+  g_object_get (G_OBJECT (screen), "title", &screen->title, NULL);
 
-  terminal_screen_update_title (screen);
+  /* the tab label, tooltip, tabs menu and window title only
+   * need an update if the title actually changed */
+  if (g_strcmp0 (old_title, screen->title) != 0)
+    g_object_notify (G_OBJECT (screen), "title");
+
+  g_free (old_title);
 }
 
 
 
-static void
-terminal_screen_vte_resize_window (VteTerminal    *terminal,
-                                   guint           width,
-                                   guint           height,
-                                   TerminalScreen *screen)
+static gboolean
+terminal_screen_title_update_tick (GtkWidget     *widget,
+                                   GdkFrameClock *frame_clock,
+                                   gpointer       user_data)
 {
-  GtkWidget *toplevel;
-
-  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  TerminalScreen *screen = TERMINAL_SCREEN (widget);
 
-  /* don't do anything if the window is already fullscreen/maximized */
-  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
-  if (!gtk_widget_get_realized (toplevel)
-      || (gdk_window_get_state (gtk_widget_get_window (toplevel))
-          & (GDK_WINDOW_STATE_MAXIMIZED | GDK_WINDOW_STATE_FULLSCREEN)) != 0)
-    return;
+  screen->title_tick_id = 0;
+  terminal_screen_title_update (screen);
 
-  /* set the terminal size and resize the window if it is active */
-  vte_terminal_set_size (terminal, width, height);
-  if (screen == terminal_window_get_active (TERMINAL_WINDOW (toplevel)))
-    terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), width, height);
+  return FALSE;
 }
 
 
 
 static gboolean
-terminal_screen_reset_activity_timeout (gpointer user_data)
+terminal_screen_title_update_timeout (gpointer user_data)
 {
   TerminalScreen *screen = TERMINAL_SCREEN (user_data);
-  GdkRGBA         active_color;
-  GdkRGBA         fg_color;
-  GdkRGBA         label_color;
 
-  if (G_UNLIKELY (screen->tab_label == NULL))
-    return FALSE;
+  screen->title_timer_id = 0;
+  terminal_screen_title_update (screen);
 
-  /* unset */
-  if (G_LIKELY (screen->custom_title_color == NULL))
-    gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
-  else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
-    terminal_screen_set_tab_label_color (screen, &label_color);
+  return FALSE;
+}
 
-  if (terminal_preferences_get_color (screen->preferences, "tab-activity-color", &active_color))
-    {
-      /* calculate color between fg and active color */
-      gtk_style_context_get_color (gtk_widget_get_style_context (screen->tab_label),
-                                   gtk_widget_get_state_flags (screen->tab_label),
-                                   &fg_color);
-      active_color.red = (active_color.red + fg_color.red) / 2;
-      active_color.green = (active_color.green + fg_color.green) / 2;
-      active_color.blue = (active_color.blue + fg_color.blue) / 2;
 
-      terminal_screen_set_tab_label_color (screen, &active_color);
+
+static void
+terminal_screen_queue_title_update (TerminalScreen *screen)
+{
+  /* postponed until the output calms down */
+  if (G_UNLIKELY (screen->flooding))
+    {
+      screen->title_pending = TRUE;
+      return;
     }
 
-  return FALSE;
+  if (screen->title_tick_id != 0 || screen->title_timer_id != 0)
+    return;
+
+  /* hidden screens do not keep the frame clock running */
+  if (!screen->hidden && gtk_widget_get_realized (GTK_WIDGET (screen)))
+    {
+      screen->title_tick_id =
+          gtk_widget_add_tick_callback (GTK_WIDGET (screen), terminal_screen_title_update_tick, NULL, NULL);
+    }
+  else
+    {
+      screen->title_timer_id =
+          terminal_timer_add (TERMINAL_WAKEUP_TITLE, HIDDEN_TITLE_UPDATE_INTERVAL,
+                              terminal_screen_title_update_timeout, screen, NULL);
+    }
 }
 
 
 
 static void
-terminal_screen_reset_activity_destroyed (gpointer user_data)
+terminal_screen_vte_window_title_changed (VteTerminal    *terminal,
+                                          TerminalScreen *screen)
 {
-  TERMINAL_SCREEN (user_data)->activity_timeout_id = 0;
+  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  /* programs may set the title many times per second */
+  terminal_screen_queue_title_update (screen);
 }
 
 
 
 static void
-terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
+terminal_screen_vte_directory_changed (VteTerminal    *terminal,
+                                       TerminalScreen *screen)
 {
-  guint           timeout;
-  GdkRGBA         color;
-  GdkRGBA         label_color;
-  gboolean        has_color;
+  const gchar *uri;
+  gchar       *directory;
 
+  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (GTK_IS_LABEL (screen->tab_label));
-  terminal_return_if_fail (TERMINAL_IS_PREFERENCES (screen->preferences));
 
-  /* leave if we should not start an update */
-  if (screen->tab_label == NULL
-      || (gtk_widget_get_state_flags (screen->terminal) & GTK_STATE_FLAG_FOCUSED) != 0
-      || time (NULL) - screen->activity_resize_time <= 1)
+  /* the shell reported its directory with OSC 7 */
+  uri = vte_terminal_get_current_directory_uri (terminal);
+  if (uri == NULL)
     return;
 
-  /* get the reset time, leave if this feature is disabled */
-  g_object_get (G_OBJECT (screen->preferences), "tab-activity-timeout", &timeout, NULL);
-  if (timeout < 1)
-    return;
+  directory = g_filename_from_uri (uri, NULL, NULL);
+  if (G_LIKELY (directory != NULL))
+    {
+      if (g_strcmp0 (directory, screen->working_directory) != 0)
+        {
+          g_free (screen->working_directory);
+          screen->working_directory = directory;
 
-  /* set label color */
-  has_color = terminal_preferences_get_color (screen->preferences, "tab-activity-color", &color);
-  if (G_LIKELY (has_color))
-    terminal_screen_set_tab_label_color (screen, &color);
-  else if (G_LIKELY (screen->custom_title_color == NULL))
-    gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
-  else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
-    terminal_screen_set_tab_label_color (screen, &label_color);
+          g_object_notify (G_OBJECT (screen), "working-directory");
+          terminal_screen_queue_title_update (screen);
+        }
+      else
+        g_free (directory);
+    }
+
+  terminal_screen_invalidate_cwd (screen);
+  screen->cwd_valid = TRUE;
+}
+
+
+
+static GPid
+terminal_screen_get_foreground_pgrp (TerminalScreen *screen)
+{
+  VtePty *pty;
+  gint    fd;
+
+  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
+  if (pty == NULL)
+    return -1;
 
-  /* stop running reset timeout */
-  if (screen->activity_timeout_id != 0)
-    g_source_remove (screen->activity_timeout_id);
+  fd = vte_pty_get_fd (pty);
+  if (fd == -1)
+    return -1;
 
-  /* start new timeout to unset the activity */
-  screen->activity_timeout_id =
-      gdk_threads_add_timeout_seconds_full (G_PRIORITY_DEFAULT, timeout,
-                                            terminal_screen_reset_activity_timeout,
-                                            screen, terminal_screen_reset_activity_destroyed);
+  return tcgetpgrp (fd);
 }
 
 
 
-static void
-terminal_screen_vte_window_contents_resized (TerminalScreen *screen)
+static gpointer
+terminal_cwd_lookup_thread (gpointer data)
 {
-  /* avoid a content changed when the window is resized */
-  screen->activity_resize_time = time (NULL);
+  TerminalCwdLookup *lookup = data;
+  gchar              buffer[4096 + 1];
+  gchar             *result = NULL;
+  gint               length;
+
+  /* this might block on a hung mount, the gui does not wait for it */
+  length = readlink (lookup->path, buffer, sizeof (buffer) - 1);
+  if (length > 0 && *buffer == '/')
+    result = g_strndup (buffer, length);
+
+  /* wake up a caller waiting for the result */
+  g_mutex_lock (&lookup->mutex);
+  lookup->result = result;
+  lookup->done = TRUE;
+  g_cond_signal (&lookup->cond);
+  g_mutex_unlock (&lookup->mutex);
+
+  /* hand the reference of the thread to the main loop */
+  gdk_threads_add_idle (terminal_cwd_lookup_finished, lookup);
+
+  return NULL;
 }
 
 
 
-static void
-terminal_screen_update_label_orientation (TerminalScreen *screen)
+static gboolean
+terminal_cwd_lookup_finished (gpointer data)
 {
-  GtkPositionType     position;
-  gdouble             angle;
-  PangoEllipsizeMode  ellipsize;
-  GtkWidget          *box;
+  TerminalCwdLookup *lookup = data;
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (screen->tab_label == NULL || GTK_IS_LABEL (screen->tab_label));
+  /* unless a caller waited for it already */
+  if (lookup->screen != NULL)
+    terminal_screen_apply_cwd (lookup->screen, lookup);
 
-  if (G_UNLIKELY (screen->tab_label == NULL))
-    return;
+  terminal_cwd_lookup_unref (lookup);
 
-  g_object_get (G_OBJECT (screen->preferences), "misc-tab-position", &position, NULL);
+  return FALSE;
+}
 
-  if (G_LIKELY (position == GTK_POS_TOP || position == GTK_POS_BOTTOM))
-    {
-      angle = 0.0;
-      ellipsize = PANGO_ELLIPSIZE_END;
-      gtk_widget_set_halign (screen->tab_label, GTK_ALIGN_START);
-      gtk_widget_set_valign (screen->tab_label, GTK_ALIGN_CENTER);
 
-      /* reset size request, ellipsize works now */
-      gtk_widget_set_size_request (screen->tab_label, -1, -1);
-    }
-  else
-    {
-      angle = position == GTK_POS_LEFT ? 90.0 : 270.0;
-      ellipsize = PANGO_ELLIPSIZE_NONE;
-      gtk_widget_set_halign (screen->tab_label, GTK_ALIGN_CENTER);
-      gtk_widget_set_valign (screen->tab_label, GTK_ALIGN_START);
 
-      /* set a minimum height of 30px, because ellipsize does not work */
-      gtk_widget_set_size_request (screen->tab_label, -1, 30);
-    }
+static void
+terminal_screen_apply_cwd (TerminalScreen    *screen,
+                           TerminalCwdLookup *lookup)
+{
+  terminal_assert (screen->cwd_lookup == lookup);
+  terminal_assert (lookup->done);
 
-  gtk_label_set_angle (GTK_LABEL (screen->tab_label), angle);
-  gtk_label_set_ellipsize (GTK_LABEL (screen->tab_label), ellipsize);
+  screen->cwd_lookup = NULL;
+  screen->cwd_valid = TRUE;
+  screen->cwd_pgrp = lookup->pgrp;
+  lookup->screen = NULL;
 
-  box = gtk_widget_get_parent (screen->tab_label);
-  terminal_return_if_fail (GTK_IS_ORIENTABLE (box));
-  gtk_orientable_set_orientation (GTK_ORIENTABLE (box),
-    angle == 0.0 ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL);
+  if (lookup->result != NULL
+      && g_strcmp0 (lookup->result, screen->working_directory) != 0)
+    {
+      g_free (screen->working_directory);
+      screen->working_directory = g_steal_pointer (&lookup->result);
+
+      g_object_notify (G_OBJECT (screen), "working-directory");
+      terminal_screen_queue_title_update (screen);
+    }
+
+  /* release the reference of the screen */
+  terminal_cwd_lookup_unref (lookup);
 }
 
 
 
 static void
-terminal_screen_urgent_bell (TerminalWidget *widget,
-                             TerminalScreen *screen)
+terminal_cwd_lookup_unref (TerminalCwdLookup *lookup)
 {
-  gboolean enabled;
+  if (g_atomic_int_dec_and_test (&lookup->ref_count))
+    {
+      g_free (lookup->path);
+      g_free (lookup->result);
+      g_mutex_clear (&lookup->mutex);
+      g_cond_clear (&lookup->cond);
+      g_slice_free (TerminalCwdLookup, lookup);
+    }
+}
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
-  g_object_get (G_OBJECT (screen->preferences), "misc-bell-urgent", &enabled, NULL);
 
-  if (enabled)
-    gtk_window_set_urgency_hint (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))), TRUE);
+static void
+terminal_screen_invalidate_cwd (TerminalScreen *screen)
+{
+  screen->cwd_valid = FALSE;
+
+  /* the result of a running lookup might be outdated, drop it */
+  if (screen->cwd_lookup != NULL)
+    {
+      screen->cwd_lookup->screen = NULL;
+      terminal_cwd_lookup_unref (screen->cwd_lookup);
+      screen->cwd_lookup = NULL;
+    }
 }
 
 
 
-static void
-terminal_screen_set_custom_command (TerminalScreen *screen,
-                                    gchar         **command)
+static gchar *
+terminal_screen_get_process_name (GPid pid)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-
-  if (G_UNLIKELY (screen->custom_command != NULL))
-    g_strfreev (screen->custom_command);
+  gchar  *path;
+  gchar  *contents = NULL;
+  gchar  *name = NULL;
+  gsize   length;
+
+  /* procfs is served by the kernel, so reading it does not block */
+  path = g_strdup_printf (PROC_PREFIX "/%d/comm", pid);
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+    name = g_strdup (g_strchomp (contents));
+  g_free (path);
+  g_free (contents);
+
+  if (name == NULL)
+    {
+      /* first argument of the command line */
+      path = g_strdup_printf (PROC_PREFIX "/%d/cmdline", pid);
+      if (g_file_get_contents (path, &contents, &length, NULL) && length > 0)
+        name = g_path_get_basename (contents);
+      g_free (path);
+      g_free (contents);
+    }
 
-  if (G_LIKELY (command != NULL && *command != NULL))
-    screen->custom_command = g_strdupv (command);
-  else
-    screen->custom_command = NULL;
+  return name;
 }
 
 
 
 static void
-terminal_screen_set_tab_label_color (TerminalScreen *screen,
-                                     const GdkRGBA  *color)
+terminal_screen_unwatch_foreground (TerminalScreen *screen)
 {
-  PangoAttrList *attrs = pango_attr_list_new ();
-  PangoAttribute *foreground = pango_attr_foreground_new ((guint16)(color->red*65535),
-                                                          (guint16)(color->green*65535),
-                                                          (guint16)(color->blue*65535));
-  pango_attr_list_insert (attrs, foreground);
-  gtk_label_set_attributes (GTK_LABEL (screen->tab_label), attrs);
-  pango_attr_list_unref (attrs);
+  if (screen->fg_watch_id != 0)
+    {
+      g_source_remove (screen->fg_watch_id);
+      screen->fg_watch_id = 0;
+    }
+
+  if (screen->fg_pidfd != -1)
+    {
+      close (screen->fg_pidfd);
+      screen->fg_pidfd = -1;
+    }
 }
 
 
 
 static gboolean
-terminal_screen_is_text_unsafe (const gchar *text)
+terminal_screen_foreground_exited (gint          fd,
+                                   GIOCondition  condition,
+                                   gpointer      user_data)
 {
-  return text != NULL && strchr (text, '\n') != NULL;
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+
+  /* the source is destroyed by returning FALSE */
+  screen->fg_watch_id = 0;
+  terminal_screen_unwatch_foreground (screen);
+
+  terminal_screen_set_foreground (screen, terminal_screen_get_foreground_pgrp (screen));
+
+  return FALSE;
 }
 
 
 
-static GtkWidget*
-terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
-                                         const gchar    *text)
+static void
+terminal_screen_set_foreground (TerminalScreen *screen,
+                                GPid            pgrp)
 {
-  GtkWindow     *parent = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen)));
-  GtkTextBuffer *buffer = gtk_text_buffer_new (gtk_text_tag_table_new ());
-  GtkWidget     *tv = gtk_text_view_new_with_buffer (buffer);
-  GtkWidget     *sw = gtk_scrolled_window_new (NULL, NULL);
-  GtkWidget     *dialog = xfce_titled_dialog_new ();
-  GtkWidget     *infobar = gtk_info_bar_new ();
-  GtkWidget     *box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 8);
-  GtkWidget     *button, *label;
-  gint           parent_w, parent_h;
+  if (screen->fg_pid == pgrp)
+    return;
 
-  gtk_window_set_transient_for (GTK_WINDOW (dialog), parent);
-  gtk_window_set_destroy_with_parent (GTK_WINDOW (dialog), TRUE);
-  gtk_window_set_title (GTK_WINDOW (dialog), _("Warning: Unsafe Paste"));
+  terminal_screen_unwatch_foreground (screen);
 
-  label = gtk_label_new (_("Pasting this text to the terminal may be dangerous as it looks like "
-                           "some commands may be executed, potentially involving root access ('sudo')."));
-  gtk_label_set_line_wrap (GTK_LABEL (label), TRUE);
-  gtk_container_add (gtk_info_bar_get_content_area (GTK_INFO_BAR (infobar)), label);
-  gtk_container_add (GTK_CONTAINER (box), infobar);
-  gtk_container_set_border_width (GTK_CONTAINER (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), 0);
-  gtk_container_add (GTK_CONTAINER (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), box);
+  screen->fg_pid = pgrp;
+  g_free (screen->fg_name);
+  screen->fg_name = pgrp > 0 ? terminal_screen_get_process_name (pgrp) : NULL;
 
-#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
-  xfce_titled_dialog_create_action_area (XFCE_TITLED_DIALOG (dialog));
+#ifdef SYS_pidfd_open
+  /* the group leader exiting usually returns the terminal to the
+   * shell, get notified about that without polling */
+  if (pgrp > 0 && pgrp != screen->pid)
+    {
+      screen->fg_pidfd = syscall (SYS_pidfd_open, pgrp, 0);
+      if (G_LIKELY (screen->fg_pidfd != -1))
+        {
+          screen->fg_watch_id =
+              g_unix_fd_add (screen->fg_pidfd, G_IO_IN,
+                             terminal_screen_foreground_exited, screen);
+        }
+    }
 #endif
 
-  button = xfce_gtk_button_new_mixed ("gtk-cancel", _("_Cancel"));
-#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
-  xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), button, GTK_RESPONSE_CANCEL);
-#else
-  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_CANCEL);
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Foreground of screen %u is %s (%d)", screen->session_id,
+           screen->fg_name != NULL ? screen->fg_name : "none", pgrp);
 #endif
 
-  button = xfce_gtk_button_new_mixed ("gtk-ok", _("_Paste"));
-#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
-  xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), button, GTK_RESPONSE_YES);
-#else
-  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_YES);
-#endif
+  /* the directory of the shell might be different when it returns */
+  terminal_screen_invalidate_cwd (screen);
 
-  gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (tv), TRUE);
-  gtk_text_view_set_monospace (GTK_TEXT_VIEW (tv), TRUE);
-  gtk_text_view_set_top_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_bottom_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_right_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_left_margin (GTK_TEXT_VIEW (tv), 6);
+  g_object_freeze_notify (G_OBJECT (screen));
+  g_object_notify (G_OBJECT (screen), "process-id");
+  g_object_notify (G_OBJECT (screen), "process-name");
+  g_object_notify (G_OBJECT (screen), "working-directory");
+  g_object_thaw_notify (G_OBJECT (screen));
 
-  gtk_window_get_size (GTK_WINDOW (parent), &parent_w, &parent_h);
-  gtk_window_set_default_size (GTK_WINDOW (dialog),
-                               CLAMP (parent_w * 0.7, 300, 1050),
-                               CLAMP (parent_h * 0.7, 200, 700));
-  gtk_scrolled_window_set_min_content_width (GTK_SCROLLED_WINDOW (sw), 300);
-  gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (sw), 200);
-  gtk_widget_set_vexpand (sw, TRUE);
+  terminal_screen_queue_title_update (screen);
+}
 
-  gtk_container_add (GTK_CONTAINER (sw), tv);
-  gtk_container_add (GTK_CONTAINER (box), sw);
 
-  gtk_text_buffer_set_text (buffer, text, -1);
 
-  return dialog;
+static gboolean
+terminal_screen_foreground_check (gpointer user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+
+  screen->fg_check_id = 0;
+  terminal_screen_set_foreground (screen, terminal_screen_get_foreground_pgrp (screen));
+
+  return FALSE;
 }
 
 
 
 static void
-terminal_screen_paste_unsafe_text (TerminalScreen *screen,
-                                   const gchar    *text,
-                                   GdkAtom         original_clipboard)
+terminal_screen_vte_resize_window (VteTerminal    *terminal,
+                                   guint           width,
+                                   guint           height,
+                                   TerminalScreen *screen)
 {
-  GtkWidget *dialog;
-
-  terminal_return_if_fail (original_clipboard != GDK_SELECTION_CLIPBOARD && original_clipboard != GDK_SELECTION_PRIMARY);
+  GtkWidget *toplevel;
 
-  dialog = terminal_screen_unsafe_paste_dialog_new (screen, text);
-  gtk_widget_show_all (dialog);
-  /* set focus to the Paste button */
-  gtk_widget_grab_focus (gtk_dialog_get_widget_for_response (GTK_DIALOG (dialog), GTK_RESPONSE_YES));
+  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
-  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_YES)
-    {
-      GtkWidget     *content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
-      GtkWidget     *sw = g_list_first (gtk_container_get_children (GTK_CONTAINER (content_area)))->data;
-      GtkTextView   *tv = GTK_TEXT_VIEW (gtk_bin_get_child (GTK_BIN (sw)));
-      GtkTextBuffer *buffer = gtk_text_view_get_buffer (tv);
-      GtkTextIter    start, end;
-      char          *res_text;
+  /* don't do anything if the window is already fullscreen/maximized */
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+  if (!gtk_widget_get_realized (toplevel)
+      || (gdk_window_get_state (gtk_widget_get_window (toplevel))
+          & (GDK_WINDOW_STATE_MAXIMIZED | GDK_WINDOW_STATE_FULLSCREEN)) != 0)
+    return;
 
-      gtk_text_buffer_get_bounds (buffer, &start, &end);
-      res_text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+  /* set the terminal size and resize the window if it is active */
+  vte_terminal_set_size (terminal, width, height);
+  if (screen == terminal_window_get_active (TERMINAL_WINDOW (toplevel)))
+    terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), width, height);
+}
 
-      if (res_text != NULL)
-        {
-          /* Modify the content of the clipboard as required, and then paste it.
-           * Using the builtin pasting function enables bracketed paste mode when applicable.
-           */
-          GtkClipboard *clipboard = gtk_clipboard_get (original_clipboard);
-          gtk_clipboard_set_text (clipboard, res_text, strlen (res_text));
-          g_free (res_text);
 
-          if (original_clipboard == GDK_SELECTION_CLIPBOARD) {
-            vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
-          } else {
-            vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
-          }
 
-          /* restore original clipboard contents */
-          gtk_clipboard_set_text (clipboard, text, strlen (text));
-        }
-    }
+static void
+terminal_screen_set_activity_label (TerminalScreen *screen,
+                                    const GdkRGBA  *color)
+{
+  GdkRGBA label_color;
 
-  gtk_widget_destroy (dialog);
+  if (color != NULL)
+    terminal_screen_set_tab_label_color (screen, color);
+  else if (G_LIKELY (screen->custom_title_color == NULL))
+    gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
+  else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
+    terminal_screen_set_tab_label_color (screen, &label_color);
 }
 
 
 
-#if VTE_CHECK_VERSION (0, 48, 0)
 static void
-terminal_screen_spawn_async_cb (VteTerminal *terminal,
-                                GPid         pid,
-                                GError      *error,
-                                gpointer     user_data)
+terminal_screen_untrack_activity (TerminalScreen *screen)
 {
-  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
-
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
+  if (!screen->activity_tracked)
+    return;
 
-  screen->pid = pid;
+  screen->activity_tracked = FALSE;
+  screen_activity_list = g_slist_remove (screen_activity_list, screen);
 
-  if (error)
-    {
-      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
-                              error, _("Failed to execute child"));
-    }
-#ifdef HAVE_LIBUTEMPTER
-  else
-    {
-      gboolean update_records;
-      g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
-      if (update_records)
-        utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
-    }
-#endif // HAVE_LIBUTEMPTER
+  /* stop the wheel timer once no screen is waiting */
+  if (screen_activity_list == NULL && screen_activity_timer_id != 0)
+    terminal_timer_remove (screen_activity_timer_id);
 }
-#endif
 
 
 
-/**
- * terminal_screen_new:
- * @attr    : Terminal attributes.
- * @columns : Columns (width).
- * @rows    : Rows (height).
- *
- * Creates a terminal screen object.
- **/
-TerminalScreen *
-terminal_screen_new (TerminalTabAttr *attr,
-                     glong            columns,
-                     glong            rows)
+static gboolean
+terminal_screen_activity_timer (gpointer user_data)
 {
-  TerminalScreen *screen = g_object_new (TERMINAL_TYPE_SCREEN, NULL);
+  TerminalPreferences *preferences;
+  TerminalScreen      *screen;
+  GSList              *lp, *lnext;
+  GdkRGBA              active_color;
+  GdkRGBA              fg_color;
+  gboolean             has_color;
+  gint64               now;
+  guint                timeout;
 
-  if (attr->command != NULL)
-    terminal_screen_set_custom_command (screen, attr->command);
-  if (attr->directory != NULL)
-    terminal_screen_set_working_directory (screen, attr->directory);
-  if (attr->title != NULL)
-    terminal_screen_set_custom_title (screen, attr->title);
-  if (attr->initial_title != NULL)
-    screen->initial_title = g_strdup (attr->initial_title);
-  screen->dynamic_title_mode = attr->dynamic_title_mode;
-  screen->hold = attr->hold;
-  vte_terminal_set_size (VTE_TERMINAL (screen->terminal), columns, rows);
+  terminal_return_val_if_fail (screen_activity_list != NULL, FALSE);
 
-  if (attr->color_text != NULL)
-    screen->custom_fg_color = g_strdup (attr->color_text);
-  if (attr->color_bg != NULL)
-    screen->custom_bg_color = g_strdup (attr->color_bg);
-  if (attr->color_text != NULL || attr->color_bg != NULL)
-    terminal_screen_update_colors (screen);
+  /* all screens share the preferences */
+  preferences = TERMINAL_SCREEN (screen_activity_list->data)->preferences;
+  g_object_get (G_OBJECT (preferences), "tab-activity-timeout", &timeout, NULL);
+  has_color = terminal_preferences_get_color (preferences, "tab-activity-color", &active_color);
 
-  return screen;
-}
+  now = g_get_monotonic_time ();
 
+  for (lp = screen_activity_list; lp != NULL; lp = lnext)
+    {
+      lnext = lp->next;
+      screen = TERMINAL_SCREEN (lp->data);
 
+      if (G_UNLIKELY (screen->tab_label == NULL || timeout < 1))
+        {
+          if (screen->activity_shown && screen->tab_label != NULL)
+            terminal_screen_set_activity_label (screen, NULL);
+          screen->activity_shown = FALSE;
+          terminal_screen_untrack_activity (screen);
+          continue;
+        }
 
-/**
- * terminal_screen_launch_child:
- * @screen  : A #TerminalScreen.
- *
- * Starts the terminal child process.
- **/
-void
-terminal_screen_launch_child (TerminalScreen *screen)
+      if (now - screen->activity_time < (gint64) timeout * G_USEC_PER_SEC)
+        {
+          /* only touch the label attributes when the state changes */
+          if (!screen->activity_shown)
+            {
+              screen->activity_shown = TRUE;
+              terminal_screen_set_activity_label (screen, has_color ? &active_color : NULL);
+            }
+          continue;
+        }
+
+      /* the output settled, fade to a color between fg and active color */
+      terminal_screen_set_activity_label (screen, NULL);
+      if (has_color)
+        {
+          gtk_style_context_get_color (gtk_widget_get_style_context (screen->tab_label),
+                                       gtk_widget_get_state_flags (screen->tab_label),
+                                       &fg_color);
+          fg_color.red = (active_color.red + fg_color.red) / 2;
+          fg_color.green = (active_color.green + fg_color.green) / 2;
+          fg_color.blue = (active_color.blue + fg_color.blue) / 2;
+
+          terminal_screen_set_tab_label_color (screen, &fg_color);
+        }
+
+      screen->activity_shown = FALSE;
+      terminal_screen_untrack_activity (screen);
+    }
+
+  return screen_activity_list != NULL;
+}
+
+
+
+static void
+terminal_screen_activity_timer_destroyed (gpointer user_data)
 {
-  GError       *error = NULL;
-  gchar        *command;
-  gchar       **argv;
-  gchar       **env;
-  gchar       **argv2;
-  guint         i, argc;
-  VtePtyFlags   pty_flags = VTE_PTY_DEFAULT;
-  GSpawnFlags   spawn_flags = G_SPAWN_SEARCH_PATH;
+  screen_activity_timer_id = 0;
+}
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+
+static void
+terminal_screen_set_flooding (TerminalScreen *screen,
+                              gboolean        flooding)
+{
+  screen->flooding = flooding;
 
 #ifdef G_ENABLE_DEBUG
-  if (!gtk_widget_get_realized (GTK_WIDGET (screen)))
-    g_error ("Tried to launch command in a TerminalScreen that is not realized");
+  g_debug ("Screen %u %s flood mode at %u bytes/s", screen->session_id,
+           flooding ? "entered" : "left", screen->output_rate);
 #endif
 
-  if (!terminal_screen_get_child_command (screen, &command, &argv, &error))
+  terminal_widget_set_matching_suspended (TERMINAL_WIDGET (screen->terminal), flooding);
+
+  if (!flooding)
     {
-      /* tell the user that we were unable to execute the command */
-      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
-                              error, _("Failed to execute child"));
-      g_error_free (error);
+      if (screen->title_pending)
+        {
+          screen->title_pending = FALSE;
+          terminal_screen_queue_title_update (screen);
+        }
+
+      /* the output during the flood was not recorded */
+      terminal_screen_record_activity (screen);
+    }
+
+  g_object_notify (G_OBJECT (screen), "flooding");
+}
+
+
+
+static gboolean
+terminal_screen_throughput_sample (gpointer user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  guint64         events;
+  guint64         bytes;
+  guint           threshold;
+  glong           row;
+  gint64          now;
+  gint64          elapsed;
+  gboolean        running = TRUE;
+
+  now = g_get_monotonic_time ();
+  elapsed = MAX (now - screen->sample_time, 1);
+  events = screen->output_events - screen->sample_events;
+
+  /* the cursor row includes the scrollback, so it keeps growing while
+   * output scrolls; the bytes are estimated from the full rows */
+  vte_terminal_get_cursor_position (VTE_TERMINAL (screen->terminal), NULL, &row);
+  if (row > screen->sample_row)
+    {
+      screen->rows_scrolled += row - screen->sample_row;
+      bytes = (guint64) (row - screen->sample_row)
+              * vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
     }
   else
+    bytes = 0;
+
+  screen->output_rate = MIN (bytes * G_USEC_PER_SEC / elapsed, G_MAXUINT);
+  screen->sample_events = screen->output_events;
+  screen->sample_row = row;
+  screen->sample_time = now;
+
+  g_object_get (G_OBJECT (screen->preferences), "misc-flood-threshold", &threshold, NULL);
+  threshold *= 1024;
+
+  /* leave flood mode at half the rate to avoid flapping */
+  if (!screen->flooding && threshold > 0 && screen->output_rate > threshold)
+    terminal_screen_set_flooding (screen, TRUE);
+  else if (screen->flooding && (threshold == 0 || screen->output_rate < threshold / 2))
+    terminal_screen_set_flooding (screen, FALSE);
+
+  /* stop sampling when the output stopped */
+  if (events == 0 && !screen->flooding)
     {
-      env = terminal_screen_get_child_environment (screen);
+      screen->sample_id = 0;
+      running = FALSE;
+    }
 
-      argc = argv != NULL ? g_strv_length (argv) : 0;
-      argv2 = g_new0 (gchar *, argc + 2);
-      argv2[0] = command;
+  g_object_freeze_notify (G_OBJECT (screen));
+  g_object_notify (G_OBJECT (screen), "output-events");
+  g_object_notify (G_OBJECT (screen), "rows-scrolled");
+  g_object_notify (G_OBJECT (screen), "output-rate");
+  g_object_thaw_notify (G_OBJECT (screen));
 
-      if (argv != NULL)
-        {
-          for (i = 0; argv[i] != NULL; i++)
-            argv2[i + 1] = argv[i];
+  return running;
+}
 
-          spawn_flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
-        }
 
-#if VTE_CHECK_VERSION (0, 48, 0)
-      vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
-                                pty_flags,
-                                screen->working_directory, argv2, env,
-                                spawn_flags,
-                                NULL, NULL,
-                                NULL, SPAWN_TIMEOUT,
-                                NULL,
-                                terminal_screen_spawn_async_cb,
-                                screen);
-#else
-      if (!vte_terminal_spawn_sync (VTE_TERMINAL (screen->terminal),
-                                    pty_flags,
-                                    screen->working_directory, argv2, env,
-                                    spawn_flags,
-                                    NULL, NULL,
-                                    &screen->pid, NULL, &error))
-        {
-          xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
-                                  error, _("Failed to execute child"));
-          g_error_free (error);
-        }
-#ifdef HAVE_LIBUTEMPTER
-      else
+
+static void
+terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  screen->output_events++;
+
+  /* start sampling the output rate */
+  if (G_UNLIKELY (screen->sample_id == 0))
+    {
+      screen->sample_time = g_get_monotonic_time ();
+      screen->sample_events = screen->output_events;
+      vte_terminal_get_cursor_position (VTE_TERMINAL (screen->terminal), NULL, &screen->sample_row);
+      screen->sample_id = terminal_timer_add (TERMINAL_WAKEUP_THROUGHPUT, THROUGHPUT_INTERVAL,
+                                              terminal_screen_throughput_sample, screen, NULL);
+    }
+
+  /* new output is the only sign of another foreground process,
+   * look it up once per timer tick */
+  if (screen->fg_check_id == 0)
+    {
+      screen->fg_check_id =
+          terminal_timer_add (TERMINAL_WAKEUP_FOREGROUND, FOREGROUND_CHECK_INTERVAL,
+                              terminal_screen_foreground_check, screen, NULL);
+    }
+
+  /* recorded when leaving flood mode */
+  if (G_LIKELY (!screen->flooding))
+    terminal_screen_record_activity (screen);
+
+  /* keep the search matches up to date */
+  if (screen->search_regex != NULL)
+    terminal_screen_search_queue_update (screen);
+}
+
+
+
+static void
+terminal_screen_record_activity (TerminalScreen *screen)
+{
+  gint64 now;
+
+  /* leave if we should not start an update */
+  if (screen->tab_label == NULL
+      || (gtk_widget_get_state_flags (screen->terminal) & GTK_STATE_FLAG_FOCUSED) != 0)
+    return;
+
+  /* this runs for every update of the terminal, only record the time
+   * here and leave the label to terminal_screen_activity_timer() */
+  now = g_get_monotonic_time ();
+
+  /* avoid a content changed when the window is resized */
+  if (now - screen->activity_resize_time <= G_USEC_PER_SEC)
+    return;
+
+  screen->activity_time = now;
+
+  if (G_UNLIKELY (!screen->activity_tracked))
+    {
+      screen->activity_tracked = TRUE;
+      screen_activity_list = g_slist_prepend (screen_activity_list, screen);
+
+      if (screen_activity_timer_id == 0)
         {
-          gboolean update_records;
-          g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
-          if (update_records)
-            utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
+          screen_activity_timer_id =
+              terminal_timer_add (TERMINAL_WAKEUP_ACTIVITY, ACTIVITY_INTERVAL,
+                                  terminal_screen_activity_timer, NULL,
+                                  terminal_screen_activity_timer_destroyed);
         }
-#endif // HAVE_LIBUTEMPTER
-#endif
+    }
+}
 
-      g_free (argv2);
 
-      g_strfreev (argv);
-      g_strfreev (env);
-      g_free (command);
+
+static void
+terminal_screen_vte_window_contents_resized (TerminalScreen *screen)
+{
+  /* avoid a content changed when the window is resized */
+  screen->activity_resize_time = g_get_monotonic_time ();
+}
+
+
+
+static gboolean
+terminal_screen_background_settled (gpointer user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+
+  /* render the final size in full quality */
+  screen->background_settle_id = 0;
+  gtk_widget_queue_draw (screen->terminal);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_screen_vte_size_allocate (GtkWidget      *widget,
+                                   GtkAllocation  *allocation,
+                                   TerminalScreen *screen)
+{
+  TerminalBackground background_mode;
+  gboolean           resized;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  /* the first allocation is not a resize */
+  resized = screen->background_width > 0
+            && (screen->background_width != allocation->width
+                || screen->background_height != allocation->height);
+  screen->background_width = allocation->width;
+  screen->background_height = allocation->height;
+
+  if (!resized || screen->background_opaque)
+    return;
+
+  g_object_get (G_OBJECT (screen->preferences), "background-mode", &background_mode, NULL);
+  if (G_LIKELY (background_mode != TERMINAL_BACKGROUND_IMAGE))
+    return;
+
+  /* restart the quiet period */
+  if (screen->background_settle_id != 0)
+    terminal_timer_remove (screen->background_settle_id);
+  screen->background_settle_id =
+      terminal_timer_add (TERMINAL_WAKEUP_BACKGROUND, BACKGROUND_SETTLE_TIMEOUT,
+                          terminal_screen_background_settled, screen, NULL);
+}
+
+
+
+static void
+terminal_screen_update_label_orientation (TerminalScreen *screen)
+{
+  GtkPositionType     position;
+  gdouble             angle;
+  PangoEllipsizeMode  ellipsize;
+  GtkWidget          *box;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (screen->tab_label == NULL || GTK_IS_LABEL (screen->tab_label));
+
+  if (G_UNLIKELY (screen->tab_label == NULL))
+    return;
+
+  g_object_get (G_OBJECT (screen->preferences), "misc-tab-position", &position, NULL);
+
+  if (G_LIKELY (position == GTK_POS_TOP || position == GTK_POS_BOTTOM))
+    {
+      angle = 0.0;
+      ellipsize = PANGO_ELLIPSIZE_END;
+      gtk_widget_set_halign (screen->tab_label, GTK_ALIGN_START);
+      gtk_widget_set_valign (screen->tab_label, GTK_ALIGN_CENTER);
+
+      /* reset size request, ellipsize works now */
+      gtk_widget_set_size_request (screen->tab_label, -1, -1);
+    }
+  else
+    {
+      angle = position == GTK_POS_LEFT ? 90.0 : 270.0;
+      ellipsize = PANGO_ELLIPSIZE_NONE;
+      gtk_widget_set_halign (screen->tab_label, GTK_ALIGN_CENTER);
+      gtk_widget_set_valign (screen->tab_label, GTK_ALIGN_START);
+
+      /* set a minimum height of 30px, because ellipsize does not work */
+      gtk_widget_set_size_request (screen->tab_label, -1, 30);
+    }
+
+  gtk_label_set_angle (GTK_LABEL (screen->tab_label), angle);
+  gtk_label_set_ellipsize (GTK_LABEL (screen->tab_label), ellipsize);
+
+  box = gtk_widget_get_parent (screen->tab_label);
+  terminal_return_if_fail (GTK_IS_ORIENTABLE (box));
+  gtk_orientable_set_orientation (GTK_ORIENTABLE (box),
+    angle == 0.0 ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL);
+}
+
+
+
+static void
+terminal_screen_urgent_bell (TerminalWidget *widget,
+                             TerminalScreen *screen)
+{
+  GtkWidget *toplevel;
+  GdkWindow *window;
+  gint64     now;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  /* refill the bucket with misc-bell-rate tokens per second */
+  now = g_get_monotonic_time ();
+  if (G_LIKELY (screen->bell_time != 0))
+    {
+      screen->bell_tokens += (gdouble) (now - screen->bell_time) * screen->bell_rate / G_USEC_PER_SEC;
+      screen->bell_tokens = MIN (screen->bell_tokens, screen->bell_burst);
+    }
+  screen->bell_time = now;
+
+  /* a bell storm, only count it */
+  if (screen->bell_tokens < 1.0)
+    {
+      screen->bells_suppressed++;
+      return;
+    }
+  screen->bell_tokens -= 1.0;
+
+  if (screen->bell_audible)
+    {
+      window = gtk_widget_get_window (GTK_WIDGET (widget));
+      if (G_LIKELY (window != NULL))
+        gdk_window_beep (window);
+    }
+
+  if (screen->bell_urgent)
+    {
+      /* avoid flooding the window manager with hint changes */
+      toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+      if (GTK_IS_WINDOW (toplevel) && !gtk_window_get_urgency_hint (GTK_WINDOW (toplevel)))
+        gtk_window_set_urgency_hint (GTK_WINDOW (toplevel), TRUE);
+    }
+}
+
+
+
+static void
+terminal_screen_set_custom_command (TerminalScreen *screen,
+                                    gchar         **command)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (G_UNLIKELY (screen->custom_command != NULL))
+    g_strfreev (screen->custom_command);
+
+  if (G_LIKELY (command != NULL && *command != NULL))
+    screen->custom_command = g_strdupv (command);
+  else
+    screen->custom_command = NULL;
+}
+
+
+
+static void
+terminal_screen_set_tab_label_color (TerminalScreen *screen,
+                                     const GdkRGBA  *color)
+{
+  PangoAttrList *attrs = pango_attr_list_new ();
+  PangoAttribute *foreground = pango_attr_foreground_new ((guint16)(color->red*65535),
+                                                          (guint16)(color->green*65535),
+                                                          (guint16)(color->blue*65535));
+  pango_attr_list_insert (attrs, foreground);
+  gtk_label_set_attributes (GTK_LABEL (screen->tab_label), attrs);
+  pango_attr_list_unref (attrs);
+}
+
+
+
+static gboolean
+terminal_screen_is_text_unsafe (const gchar *text)
+{
+  return text != NULL && strchr (text, '\n') != NULL;
+}
+
+
+
+static GtkWidget*
+terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
+                                         const gchar    *text)
+{
+  GtkWindow     *parent = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen)));
+  GtkTextBuffer *buffer = gtk_text_buffer_new (gtk_text_tag_table_new ());
+  GtkWidget     *tv = gtk_text_view_new_with_buffer (buffer);
+  GtkWidget     *sw = gtk_scrolled_window_new (NULL, NULL);
+  GtkWidget     *dialog = xfce_titled_dialog_new ();
+  GtkWidget     *infobar = gtk_info_bar_new ();
+  GtkWidget     *box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 8);
+  GtkWidget     *button, *label;
+  gint           parent_w, parent_h;
+
+  gtk_window_set_transient_for (GTK_WINDOW (dialog), parent);
+  gtk_window_set_destroy_with_parent (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_title (GTK_WINDOW (dialog), _("Warning: Unsafe Paste"));
+
+  label = gtk_label_new (_("Pasting this text to the terminal may be dangerous as it looks like "
+                           "some commands may be executed, potentially involving root access ('sudo')."));
+  gtk_label_set_line_wrap (GTK_LABEL (label), TRUE);
+  gtk_container_add (gtk_info_bar_get_content_area (GTK_INFO_BAR (infobar)), label);
+  gtk_container_add (GTK_CONTAINER (box), infobar);
+  gtk_container_set_border_width (GTK_CONTAINER (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), 0);
+  gtk_container_add (GTK_CONTAINER (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), box);
+
+#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
+  xfce_titled_dialog_create_action_area (XFCE_TITLED_DIALOG (dialog));
+#endif
+
+  button = xfce_gtk_button_new_mixed ("gtk-cancel", _("_Cancel"));
+#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
+  xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), button, GTK_RESPONSE_CANCEL);
+#else
+  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_CANCEL);
+#endif
+
+  button = xfce_gtk_button_new_mixed ("gtk-ok", _("_Paste"));
+#if LIBXFCE4UI_CHECK_VERSION (4, 16, 0)
+  xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), button, GTK_RESPONSE_YES);
+#else
+  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_YES);
+#endif
+
+  gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (tv), TRUE);
+  gtk_text_view_set_monospace (GTK_TEXT_VIEW (tv), TRUE);
+  gtk_text_view_set_top_margin (GTK_TEXT_VIEW (tv), 6);
+  gtk_text_view_set_bottom_margin (GTK_TEXT_VIEW (tv), 6);
+  gtk_text_view_set_right_margin (GTK_TEXT_VIEW (tv), 6);
+  gtk_text_view_set_left_margin (GTK_TEXT_VIEW (tv), 6);
+
+  gtk_window_get_size (GTK_WINDOW (parent), &parent_w, &parent_h);
+  gtk_window_set_default_size (GTK_WINDOW (dialog),
+                               CLAMP (parent_w * 0.7, 300, 1050),
+                               CLAMP (parent_h * 0.7, 200, 700));
+  gtk_scrolled_window_set_min_content_width (GTK_SCROLLED_WINDOW (sw), 300);
+  gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (sw), 200);
+  gtk_widget_set_vexpand (sw, TRUE);
+
+  gtk_container_add (GTK_CONTAINER (sw), tv);
+  gtk_container_add (GTK_CONTAINER (box), sw);
+
+  gtk_text_buffer_set_text (buffer, text, -1);
+
+  return dialog;
+}
+
+
+
+static void
+terminal_screen_paste_unsafe_text (TerminalScreen *screen,
+                                   const gchar    *text,
+                                   GdkAtom         original_clipboard)
+{
+  GtkWidget *dialog;
+
+  terminal_return_if_fail (original_clipboard != GDK_SELECTION_CLIPBOARD && original_clipboard != GDK_SELECTION_PRIMARY);
+
+  dialog = terminal_screen_unsafe_paste_dialog_new (screen, text);
+  gtk_widget_show_all (dialog);
+  /* set focus to the Paste button */
+  gtk_widget_grab_focus (gtk_dialog_get_widget_for_response (GTK_DIALOG (dialog), GTK_RESPONSE_YES));
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_YES)
+    {
+      GtkWidget     *content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
+      GtkWidget     *sw = g_list_first (gtk_container_get_children (GTK_CONTAINER (content_area)))->data;
+      GtkTextView   *tv = GTK_TEXT_VIEW (gtk_bin_get_child (GTK_BIN (sw)));
+      GtkTextBuffer *buffer = gtk_text_view_get_buffer (tv);
+      GtkTextIter    start, end;
+      char          *res_text;
+
+      gtk_text_buffer_get_bounds (buffer, &start, &end);
+      res_text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+
+      if (res_text != NULL)
+        {
+          /* Modify the content of the clipboard as required, and then paste it.
+           * Using the builtin pasting function enables bracketed paste mode when applicable.
+           */
+          GtkClipboard *clipboard = gtk_clipboard_get (original_clipboard);
+          gtk_clipboard_set_text (clipboard, res_text, strlen (res_text));
+          g_free (res_text);
+
+          if (original_clipboard == GDK_SELECTION_CLIPBOARD) {
+            vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
+          } else {
+            vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
+          }
+
+          /* restore original clipboard contents */
+          gtk_clipboard_set_text (clipboard, text, strlen (text));
+        }
+    }
+
+  gtk_widget_destroy (dialog);
+}
+
+
+
+#if VTE_CHECK_VERSION (0, 48, 0)
+static void
+terminal_screen_spawn_async_cb (VteTerminal *terminal,
+                                GPid         pid,
+                                GError      *error,
+                                gpointer     user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
+
+  screen->pid = pid;
+
+  if (error)
+    {
+      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                              error, _("Failed to execute child"));
+    }
+#ifdef HAVE_LIBUTEMPTER
+  else
+    {
+      gboolean update_records;
+      g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
+      if (update_records)
+        utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
+    }
+#endif // HAVE_LIBUTEMPTER
+}
+#endif
+
+
+
+/**
+ * terminal_screen_new:
+ * @attr    : Terminal attributes.
+ * @columns : Columns (width).
+ * @rows    : Rows (height).
+ *
+ * Creates a terminal screen object.
+ **/
+TerminalScreen *
+terminal_screen_new (TerminalTabAttr *attr,
+                     glong            columns,
+                     glong            rows)
+{
+  TerminalScreen *screen = g_object_new (TERMINAL_TYPE_SCREEN, NULL);
+
+  if (attr->command != NULL)
+    terminal_screen_set_custom_command (screen, attr->command);
+  if (attr->directory != NULL)
+    terminal_screen_set_working_directory (screen, attr->directory);
+  if (attr->title != NULL)
+    terminal_screen_set_custom_title (screen, attr->title);
+  if (attr->initial_title != NULL)
+    screen->initial_title = g_strdup (attr->initial_title);
+  screen->dynamic_title_mode = attr->dynamic_title_mode;
+  screen->hold = attr->hold;
+  vte_terminal_set_size (VTE_TERMINAL (screen->terminal), columns, rows);
+
+  if (attr->color_text != NULL)
+    screen->custom_fg_color = g_strdup (attr->color_text);
+  if (attr->color_bg != NULL)
+    screen->custom_bg_color = g_strdup (attr->color_bg);
+  if (attr->color_text != NULL || attr->color_bg != NULL)
+    terminal_screen_update_colors (screen);
+
+  return screen;
+}
+
+
+
+/**
+ * terminal_screen_launch_child:
+ * @screen  : A #TerminalScreen.
+ *
+ * Starts the terminal child process.
+ **/
+void
+terminal_screen_launch_child (TerminalScreen *screen)
+{
+  GError       *error = NULL;
+  gchar        *command;
+  gchar       **argv;
+  gchar       **env;
+  gchar       **argv2;
+  guint         i, argc;
+  VtePtyFlags   pty_flags = VTE_PTY_DEFAULT;
+  GSpawnFlags   spawn_flags = G_SPAWN_SEARCH_PATH;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+#ifdef G_ENABLE_DEBUG
+  if (!gtk_widget_get_realized (GTK_WIDGET (screen)))
+    g_error ("Tried to launch command in a TerminalScreen that is not realized");
+#endif
+
+  if (!terminal_screen_get_child_command (screen, &command, &argv, &error))
+    {
+      /* tell the user that we were unable to execute the command */
+      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                              error, _("Failed to execute child"));
+      g_error_free (error);
+    }
+  else
+    {
+      env = terminal_screen_get_child_environment (screen);
+
+      argc = argv != NULL ? g_strv_length (argv) : 0;
+      argv2 = g_new0 (gchar *, argc + 2);
+      argv2[0] = command;
+
+      if (argv != NULL)
+        {
+          for (i = 0; argv[i] != NULL; i++)
+            argv2[i + 1] = argv[i];
+
+          spawn_flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
+        }
+
+#if VTE_CHECK_VERSION (0, 48, 0)
+      vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
+                                pty_flags,
+                                screen->working_directory, argv2, env,
+                                spawn_flags,
+                                NULL, NULL,
+                                NULL, SPAWN_TIMEOUT,
+                                NULL,
+                                terminal_screen_spawn_async_cb,
+                                screen);
+#else
+      if (!vte_terminal_spawn_sync (VTE_TERMINAL (screen->terminal),
+                                    pty_flags,
+                                    screen->working_directory, argv2, env,
+                                    spawn_flags,
+                                    NULL, NULL,
+                                    &screen->pid, NULL, &error))
+        {
+          xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                  error, _("Failed to execute child"));
+          g_error_free (error);
+        }
+#ifdef HAVE_LIBUTEMPTER
+      else
+        {
+          gboolean update_records;
+          g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
+          if (update_records)
+            utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
+        }
+#endif // HAVE_LIBUTEMPTER
+#endif
+
+      g_free (argv2);
+
+      g_strfreev (argv);
+      g_strfreev (env);
+      g_free (command);
+    }
+}
+
+
+
+/**
+ * terminal_screen_get_custom_title:
+ * @screen  : A #TerminalScreen.
+ **/
+const gchar *
+terminal_screen_get_custom_title (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  return screen->custom_title;
+}
+
+
+
+/**
+ * terminal_screen_set_custom_title:
+ * @screen  : A #TerminalScreen.
+ * @title   : Title string.
+ **/
+void
+terminal_screen_set_custom_title (TerminalScreen *screen,
+                                  const gchar    *title)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (g_strcmp0 (screen->custom_title, title) != 0)
+    {
+      g_free (screen->custom_title);
+      if (IS_STRING (title))
+        screen->custom_title = g_strdup (title);
+      else
+        screen->custom_title = NULL;
+      g_object_notify (G_OBJECT (screen), "custom-title");
+      terminal_screen_update_title (screen);
+    }
+}
+
+
+
+/**
+ **/
+void
+terminal_screen_get_size (TerminalScreen *screen,
+                          glong          *width_chars,
+                          glong          *height_chars)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (width_chars)
+    *width_chars = vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
+
+  if (height_chars)
+    *height_chars = vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal));
+}
+
+
+
+/**
+ **/
+void
+terminal_screen_set_size (TerminalScreen *screen,
+                          glong           width_chars,
+                          glong           height_chars)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  vte_terminal_set_size (VTE_TERMINAL (screen->terminal),
+                         width_chars, height_chars);
+}
+
+
+
+void
+terminal_screen_get_geometry (TerminalScreen *screen,
+                              glong          *char_width,
+                              glong          *char_height,
+                              gint           *xpad,
+                              gint           *ypad)
+{
+  GtkBorder border;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
+
+  if (char_width != NULL)
+    *char_width = vte_terminal_get_char_width (VTE_TERMINAL (screen->terminal));
+  if (char_height != NULL)
+    *char_height = vte_terminal_get_char_height (VTE_TERMINAL (screen->terminal));
+
+  if (xpad != NULL || ypad != NULL)
+    {
+      gtk_style_context_get_padding (gtk_widget_get_style_context (screen->terminal),
+                                     gtk_widget_get_state_flags (screen->terminal),
+                                     &border);
+      if (xpad != NULL)
+        *xpad = border.left + border.right;
+      if (ypad != NULL)
+        *ypad = border.top + border.bottom;
+    }
+}
+
+
+
+/**
+ * terminal_screen_set_window_geometry_hints:
+ *
+ * I don't like this way, but its required to work-around a Gtk+
+ * bug (maybe also caused by a Vte bug, not sure).
+ *
+ * For a mapped #TerminalWindow the hints are queued and set once
+ * per frame, see terminal_window_queue_geometry_hints().
+ **/
+void
+terminal_screen_set_window_geometry_hints (TerminalScreen *screen,
+                                           GtkWindow      *window)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (GTK_IS_WINDOW (window));
+
+  if (TERMINAL_IS_WINDOW (window) && gtk_widget_get_mapped (GTK_WIDGET (window)))
+    terminal_window_queue_geometry_hints (TERMINAL_WINDOW (window), screen);
+  else
+    terminal_screen_apply_window_geometry_hints (screen, window);
+}
+
+
+
+/**
+ * terminal_screen_apply_window_geometry_hints:
+ *
+ * Sets the geometry hints of @window for @screen right away.
+ *
+ * Code for GTK > 3.19.5 borrowed from gnome-terminal
+ * (terminal_window_update_geometry).
+ **/
+void
+terminal_screen_apply_window_geometry_hints (TerminalScreen *screen,
+                                             GtkWindow      *window)
+{
+  GdkGeometry    hints;
+  glong          char_width, char_height;
+  GtkRequisition vbox_request;
+  GtkAllocation  toplevel_allocation, vbox_allocation;
+  glong          grid_width, grid_height;
+  glong          chrome_width, chrome_height;
+  gint           csd_width, csd_height;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
+  terminal_return_if_fail (gtk_widget_get_realized (GTK_WIDGET (screen)));
+  terminal_return_if_fail (gtk_widget_get_realized (GTK_WIDGET (window)));
+
+  terminal_screen_get_geometry (screen, &char_width, &char_height, NULL, NULL);
+  terminal_screen_get_size (screen, &grid_width, &grid_height);
+
+  gtk_widget_get_preferred_size (terminal_window_get_vbox (TERMINAL_WINDOW (window)), NULL, &vbox_request);
+  chrome_width = vbox_request.width - (char_width * grid_width);
+  chrome_height = vbox_request.height - (char_height * grid_height);
+
+  gtk_widget_get_allocation (terminal_window_get_vbox (TERMINAL_WINDOW (window)), &vbox_allocation);
+  gtk_widget_get_allocation (GTK_WIDGET (window), &toplevel_allocation);
+  csd_width = toplevel_allocation.width - vbox_allocation.width;
+  csd_height = toplevel_allocation.height - vbox_allocation.height;
+
+  hints.base_width = chrome_width + csd_width;
+  hints.base_height = chrome_height + csd_height;
+
+  hints.width_inc = char_width;
+  hints.height_inc = char_height;
+  hints.min_width = hints.base_width + hints.width_inc * MIN_COLUMNS;
+  hints.min_height = hints.base_height + hints.height_inc * MIN_ROWS;
+
+  gtk_window_set_geometry_hints (window,
+                                 NULL,
+                                 &hints,
+                                 GDK_HINT_RESIZE_INC
+                                 | GDK_HINT_MIN_SIZE
+                                 | GDK_HINT_BASE_SIZE);
+}
+
+
+
+/**
+ * terminal_screen_force_resize_window:
+ *
+ * I don't like this way, but its required to work-around a Gtk+
+ * bug (maybe also caused by a Vte bug, not sure).
+ *
+ * For a mapped #TerminalWindow the resize is queued and applied once
+ * per frame, see terminal_window_queue_geometry().
+ **/
+void
+terminal_screen_force_resize_window (TerminalScreen *screen,
+                                     GtkWindow      *window,
+                                     glong           columns,
+                                     glong           rows)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (GTK_IS_WINDOW (window));
+
+  if (TERMINAL_IS_WINDOW (window) && gtk_widget_get_mapped (GTK_WIDGET (window)))
+    terminal_window_queue_geometry (TERMINAL_WINDOW (window), screen, columns, rows);
+  else
+    terminal_screen_apply_window_size (screen, window, columns, rows);
+}
+
+
+
+/**
+ * terminal_screen_apply_window_size:
+ *
+ * Sets the geometry hints and resizes @window to fit @columns and @rows
+ * of @screen right away.
+ **/
+void
+terminal_screen_apply_window_size (TerminalScreen *screen,
+                                   GtkWindow      *window,
+                                   glong           columns,
+                                   glong           rows)
+{
+  GtkRequisition terminal_requisition;
+  GtkRequisition vbox_requisition;
+  gint           width;
+  gint           height;
+  gint           xpad, ypad;
+  glong          char_width;
+  glong          char_height;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
+  terminal_return_if_fail (GTK_IS_WINDOW (window));
+
+  terminal_screen_apply_window_geometry_hints (screen, window);
+
+  gtk_widget_get_preferred_size (terminal_window_get_vbox (TERMINAL_WINDOW (window)), NULL, &vbox_requisition);
+  gtk_widget_get_preferred_size (screen->terminal, NULL, &terminal_requisition);
+
+  if (columns < 1)
+    columns = vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
+  if (rows < 1)
+    rows = vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal));
+
+  terminal_screen_get_geometry (screen,
+                                &char_width, &char_height,
+                                &xpad, &ypad);
+
+  width = vbox_requisition.width - terminal_requisition.width;
+  if (width < 0)
+    width = 0;
+  width += xpad + char_width * columns;
+
+  height = vbox_requisition.height - terminal_requisition.height;
+  if (height < 0)
+    height = 0;
+  height += ypad + char_height * rows;
+
+  if (gtk_widget_get_mapped (GTK_WIDGET (window)))
+    gtk_window_resize (window, width, height);
+  else
+    gtk_window_set_default_size (window, width, height);
+}
+
+
+
+/**
+ * terminal_screen_get_title:
+ * @screen      : A #TerminalScreen.
+ *
+ * Return value : The title to set for this terminal screen.
+ *                The returned string should be freed when
+ *                no longer needed.
+ **/
+gchar*
+terminal_screen_get_title (TerminalScreen *screen)
+{
+  TerminalTitle  mode;
+  const gchar   *vte_title;
+  gchar         *initial, *tmp;
+  gchar         *title;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  if (G_UNLIKELY (screen->custom_title != NULL))
+    return terminal_screen_parse_title (screen, screen->custom_title);
+
+  vte_title = vte_terminal_get_window_title (VTE_TERMINAL (screen->terminal));
+
+  if (G_UNLIKELY (screen->initial_title != NULL))
+    initial = terminal_screen_parse_title (screen, screen->initial_title);
+  else
+    {
+      g_object_get (G_OBJECT (screen->preferences), "title-initial", &tmp, NULL);
+      initial = terminal_screen_parse_title (screen, tmp);
+      g_free (tmp);
+    }
+
+  if (G_UNLIKELY (screen->dynamic_title_mode != TERMINAL_TITLE_DEFAULT))
+    mode = screen->dynamic_title_mode;
+  else
+    g_object_get (G_OBJECT (screen->preferences), "title-mode", &mode, NULL);
+
+  switch (mode)
+    {
+    case TERMINAL_TITLE_REPLACE:
+      if (G_LIKELY (vte_title != NULL))
+        title = g_strdup (vte_title);
+      else if (initial != NULL)
+        return initial;
+      else
+        title = g_strdup (_("Untitled"));
+      break;
+
+    case TERMINAL_TITLE_PREPEND:
+      if (G_LIKELY (vte_title != NULL))
+        title = g_strconcat (vte_title, " - ", initial, NULL);
+      else
+        return initial;
+      break;
+
+    case TERMINAL_TITLE_APPEND:
+      if (G_LIKELY (vte_title != NULL))
+        title = g_strconcat (initial, " - ", vte_title, NULL);
+      else
+        return initial;
+      break;
+
+    case TERMINAL_TITLE_HIDE:
+      return initial;
+      break;
+
+    default:
+      terminal_assert_not_reached ();
+      title = NULL;
+    }
+
+  g_free (initial);
+
+  return title;
+}
+
+
+
+static const gchar *
+terminal_screen_update_working_directory (TerminalScreen *screen,
+                                          gboolean        wait)
+{
+  TerminalCwdLookup *lookup;
+  const gchar       *uri;
+  GThread           *thread;
+  GPid               pgrp;
+  gint64             end_time;
+  gboolean           done;
+
+  /* try to use vte functionality first: see bug #13902 */
+  uri = vte_terminal_get_current_directory_uri (VTE_TERMINAL (screen->terminal));
+  if (uri != NULL)
+    {
+      if (!screen->cwd_valid)
+        terminal_screen_vte_directory_changed (VTE_TERMINAL (screen->terminal), screen);
+      return screen->working_directory;
+    }
+
+  if (screen->pid < 0)
+    return screen->working_directory;
+
+  /* the cache is also invalid if another process took the foreground,
+   * a plain cd of the shell is only noticed by looking again */
+  pgrp = terminal_screen_get_foreground_pgrp (screen);
+  if (!wait && screen->cwd_valid && pgrp == screen->cwd_pgrp)
+    return screen->working_directory;
+
+  /* a lookup for this process group is still running, a finished
+   * one might be older than the question */
+  lookup = screen->cwd_lookup;
+  done = FALSE;
+  if (lookup != NULL && wait)
+    {
+      g_mutex_lock (&lookup->mutex);
+      done = lookup->done;
+      g_mutex_unlock (&lookup->mutex);
+    }
+  if (lookup == NULL || lookup->pgrp != pgrp || done)
+    {
+      terminal_screen_invalidate_cwd (screen);
+
+      lookup = g_slice_new0 (TerminalCwdLookup);
+      lookup->ref_count = 2;
+      lookup->screen = screen;
+      lookup->pgrp = pgrp;
+      lookup->path = g_strdup_printf (PROC_PREFIX "/%d/cwd", screen->pid);
+      g_mutex_init (&lookup->mutex);
+      g_cond_init (&lookup->cond);
+
+      thread = g_thread_try_new ("cwd-lookup", terminal_cwd_lookup_thread, lookup, NULL);
+      if (G_UNLIKELY (thread == NULL))
+        {
+          /* release the reference of the thread and ours */
+          lookup->ref_count = 1;
+          terminal_cwd_lookup_unref (lookup);
+          return screen->working_directory;
+        }
+      g_thread_unref (thread);
+
+      screen->cwd_lookup = lookup;
+    }
+
+  if (!wait)
+    return screen->working_directory;
+
+  /* procfs normally answers right away, only a hung mount makes
+   * the caller fall back to the last known directory */
+  end_time = g_get_monotonic_time () + CWD_LOOKUP_TIMEOUT * G_TIME_SPAN_MILLISECOND;
+  g_mutex_lock (&lookup->mutex);
+  while (!lookup->done)
+    if (!g_cond_wait_until (&lookup->cond, &lookup->mutex, end_time))
+      break;
+  done = lookup->done;
+  g_mutex_unlock (&lookup->mutex);
+
+  if (done)
+    terminal_screen_apply_cwd (screen, lookup);
+
+  return screen->working_directory;
+}
+
+
+
+/**
+ * terminal_screen_get_working_directory:
+ * @screen      : A #TerminalScreen.
+ *
+ * Determines the working directory using the OSC 7 directory reported
+ * by the shell or the procfs entry of the child. procfs is resolved on
+ * a worker, this waits CWD_LOOKUP_TIMEOUT for it and returns the last
+ * known directory if it takes longer, #TerminalScreen:working-directory
+ * is notified once the lookup finished with another directory.
+ *
+ * Return value : The current working directory of @screen.
+ **/
+const gchar*
+terminal_screen_get_working_directory (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  return terminal_screen_update_working_directory (screen, TRUE);
+}
+
+
+
+/**
+ * terminal_screen_peek_working_directory:
+ * @screen      : A #TerminalScreen.
+ *
+ * Like terminal_screen_get_working_directory(), but never waits and
+ * only returns the cached directory if it is known to be current,
+ * which is until the foreground process changes.
+ *
+ * Return value : The working directory of @screen or %NULL.
+ **/
+const gchar*
+terminal_screen_peek_working_directory (TerminalScreen *screen)
+{
+  const gchar *directory;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  /* refreshes the cache in the background if needed */
+  directory = terminal_screen_update_working_directory (screen, FALSE);
+
+  return screen->cwd_valid ? directory : NULL;
+}
+
+
+
+/**
+ * terminal_screen_set_working_directory:
+ * @screen    : A #TerminalScreen.
+ * @directory :
+ **/
+void
+terminal_screen_set_working_directory (TerminalScreen *screen,
+                                       const gchar    *directory)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (directory != NULL);
+
+  g_free (screen->working_directory);
+  screen->working_directory = g_strdup (directory);
+  terminal_screen_invalidate_cwd (screen);
+}
+
+
+
+/**
+ * terminal_screen_has_selection:
+ * @screen      : A #TerminalScreen.
+ *
+ * Checks if the terminal currently contains selected text. Note that this is different from
+ * determining if the terminal is the owner of any GtkClipboard items.
+ *
+ * Return value : %TRUE if part of the text in the terminal is selected.
+ **/
+gboolean
+terminal_screen_has_selection (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
+  return vte_terminal_get_has_selection (VTE_TERMINAL (screen->terminal));
+}
+
+
+
+/**
+ * terminal_screen_copy_clipboard:
+ * @screen  : A #TerminalScreen.
+ *
+ * Places the selected text in the terminal in the #GDK_SELECTION_CLIPBOARD selection.
+ **/
+void
+terminal_screen_copy_clipboard (TerminalScreen *screen)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+#if VTE_CHECK_VERSION (0, 49, 2)
+  vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_TEXT);
+#else
+  vte_terminal_copy_clipboard (VTE_TERMINAL (screen->terminal));
+#endif
+}
+
+
+
+/**
+ * terminal_screen_copy_clipboard_html:
+ * @screen  : A #TerminalScreen.
+ *
+ * Places the selected text in the terminal in the #GDK_SELECTION_CLIPBOARD selection
+ * as HTML (preserving colors, bold font, etc).
+ **/
+#if VTE_CHECK_VERSION (0, 49, 2)
+void
+terminal_screen_copy_clipboard_html (TerminalScreen *screen)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_HTML);
+}
+#endif
+
+
+
+/**
+ * terminal_screen_paste_clipboard:
+ * @screen  : A #TerminalScreen.
+ *
+ * Sends the contents of the #GDK_SELECTION_CLIPBOARD selection to the terminal's
+ * child. If neccessary, the data is converted from UTF-8 to the terminal's current
+ * encoding.
+ **/
+void
+terminal_screen_paste_clipboard (TerminalScreen *screen)
+{
+  gboolean  show_dialog;
+  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_CLIPBOARD));
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
+
+  if (show_dialog && terminal_screen_is_text_unsafe (text))
+    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_CLIPBOARD);
+  else
+    vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
+
+  g_free (text);
+}
+
+
+
+/**
+ * terminal_screen_paste_primary:
+ * @screen : A #TerminalScreen.
+ *
+ * Sends the contents of the #GDK_SELECTION_PRIMARY selection to the terminal's child.
+ * If necessary, the data is converted from UTF-8 to the terminal's current encoding.
+ * The terminal will call also paste the #GDK_SELECTION_PRIMARY selection when the user
+ * clicks with the the second mouse button.
+ **/
+void
+terminal_screen_paste_primary (TerminalScreen *screen)
+{
+  gboolean  show_dialog;
+  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_PRIMARY));
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
+
+  if (show_dialog && terminal_screen_is_text_unsafe (text))
+    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_PRIMARY);
+  else
+    vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
+
+  g_free (text);
+}
+
+
+
+/**
+ * terminal_screen_select_all:
+ * @screen : A #TerminalScreen.
+ *
+ * Selects all text in the terminal.
+ **/
+void
+terminal_screen_select_all (TerminalScreen *screen)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  vte_terminal_select_all (VTE_TERMINAL (screen->terminal));
+}
+
+
+
+/**
+ * terminal_screen_reset:
+ * @screen  : A #TerminalScreen.
+ * @clear   : %TRUE to also clear the terminal screen.
+ *
+ * Resets the terminal.
+ **/
+void
+terminal_screen_reset (TerminalScreen *screen,
+                       gboolean        clear)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  vte_terminal_reset (VTE_TERMINAL (screen->terminal), TRUE, clear);
+
+  if (clear)
+    vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), NULL, 0);
+}
+
+
+
+/**
+ * terminal_screen_get_restart_command:
+ * @screen  : A #TerminalScreen.
+ *
+ * Return value: Command to restore @screen, arguments are in reversed order.
+ **/
+GSList*
+terminal_screen_get_restart_command (TerminalScreen *screen)
+{
+  const gchar *directory;
+  GSList      *result = NULL;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  if (screen->custom_command != NULL)
+    {
+      result = g_slist_prepend (result, g_strdup ("-e"));
+      result = g_slist_prepend (result, g_strjoinv (" ", screen->custom_command));
+    }
+
+  if (screen->custom_title != NULL)
+    {
+      result = g_slist_prepend (result, g_strdup ("--title"));
+      result = g_slist_prepend (result, g_strdup (screen->custom_title));
+    }
+
+  directory = terminal_screen_get_working_directory (screen);
+  if (G_LIKELY (directory != NULL))
+    {
+      result = g_slist_prepend (result, g_strdup ("--working-directory"));
+      result = g_slist_prepend (result, g_strdup (directory));
     }
+
+  if (G_UNLIKELY (screen->hold))
+    result = g_slist_prepend (result, g_strdup ("--hold"));
+
+  return result;
 }
 
 
 
-/**
- * terminal_screen_get_custom_title:
- * @screen  : A #TerminalScreen.
- **/
-const gchar *
-terminal_screen_get_custom_title (TerminalScreen *screen)
+void
+terminal_screen_reset_activity (TerminalScreen *screen)
 {
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
-  return screen->custom_title;
+  terminal_screen_untrack_activity (screen);
+  screen->activity_shown = FALSE;
+
+  if (screen->tab_label != NULL)
+    terminal_screen_set_activity_label (screen, NULL);
 }
 
 
 
-/**
- * terminal_screen_set_custom_title:
- * @screen  : A #TerminalScreen.
- * @title   : Title string.
- **/
-void
-terminal_screen_set_custom_title (TerminalScreen *screen,
-                                  const gchar    *title)
+static void
+terminal_screen_close_tab_cb (TerminalScreen *screen)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  g_signal_emit (G_OBJECT (screen), screen_signals[CLOSE_TAB], 0);
+}
 
-  if (g_strcmp0 (screen->custom_title, title) != 0)
+
+
+static gboolean
+terminal_screen_query_tooltip (GtkWidget      *widget,
+                               gint            x,
+                               gint            y,
+                               gboolean        keyboard_mode,
+                               GtkTooltip     *tooltip,
+                               TerminalScreen *screen)
+{
+  GString *text;
+  gchar   *size;
+
+  /* only built when shown, the statistics change all the time */
+  text = g_string_new (gtk_label_get_text (GTK_LABEL (widget)));
+
+  if (screen->fg_name != NULL)
+    g_string_append_printf (text, "\n%s (%d)", screen->fg_name, screen->fg_pid);
+
+  if (screen->bells_suppressed > 0)
     {
-      g_free (screen->custom_title);
-      if (IS_STRING (title))
-        screen->custom_title = g_strdup (title);
+      g_string_append_c (text, '\n');
+      g_string_append_printf (text, ngettext ("%u bell suppressed", "%u bells suppressed",
+                                              screen->bells_suppressed),
+                              screen->bells_suppressed);
+    }
+
+  if (screen->output_rate > 0)
+    {
+      size = g_format_size (screen->output_rate);
+      g_string_append_c (text, '\n');
+      if (screen->flooding)
+        g_string_append_printf (text, _("Output: %s/s (flooding)"), size);
       else
-        screen->custom_title = NULL;
-      g_object_notify (G_OBJECT (screen), "custom-title");
-      terminal_screen_update_title (screen);
+        g_string_append_printf (text, _("Output: %s/s"), size);
+      g_free (size);
     }
+
+  gtk_tooltip_set_text (tooltip, text->str);
+  g_string_free (text, TRUE);
+
+  return TRUE;
 }
 
 
 
-/**
- **/
-void
-terminal_screen_get_size (TerminalScreen *screen,
-                          glong          *width_chars,
-                          glong          *height_chars)
+GtkWidget *
+terminal_screen_get_tab_label (TerminalScreen *screen)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  GtkWidget *hbox, *button, *image;
 
-  if (width_chars)
-    *width_chars = vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
 
-  if (height_chars)
-    *height_chars = vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal));
+  /* create the box */
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  gtk_container_set_border_width (GTK_CONTAINER (hbox), 2);
+
+  screen->tab_label = gtk_label_new (NULL);
+  gtk_widget_set_margin_start (screen->tab_label, 2);
+  gtk_box_pack_start  (GTK_BOX (hbox), screen->tab_label, TRUE, TRUE, 0);
+  g_object_bind_property (G_OBJECT (screen), "title",
+                          G_OBJECT (screen->tab_label), "label",
+                          G_BINDING_SYNC_CREATE);
+  g_signal_connect (G_OBJECT (screen->tab_label), "query-tooltip",
+                    G_CALLBACK (terminal_screen_query_tooltip), screen);
+  gtk_widget_set_has_tooltip (screen->tab_label, TRUE);
+
+  button = gtk_button_new ();
+  gtk_widget_set_focus_on_click (button, FALSE);
+  gtk_button_set_relief (GTK_BUTTON (button), GTK_RELIEF_NONE);
+  gtk_widget_set_can_focus (button, FALSE);
+  gtk_widget_set_can_default (button, FALSE);
+  gtk_widget_set_tooltip_text (button, _("Close this tab"));
+  gtk_widget_set_halign (button, GTK_ALIGN_CENTER);
+  gtk_widget_set_valign (button, GTK_ALIGN_CENTER);
+  gtk_container_add (GTK_CONTAINER (hbox), button);
+  g_signal_connect_swapped (G_OBJECT (button), "clicked",
+                            G_CALLBACK (terminal_screen_close_tab_cb), screen);
+
+  /* button image */
+  image = gtk_image_new_from_icon_name ("window-close-symbolic", GTK_ICON_SIZE_MENU);
+  gtk_container_add (GTK_CONTAINER (button), image);
+
+  /* show the box and all its widgets */
+  gtk_widget_show_all (hbox);
+
+  /* update orientation */
+  terminal_screen_update_label_orientation (screen);
+
+  /* respect the show/hide buttons option */
+  g_object_bind_property (G_OBJECT (screen->preferences), "misc-tab-close-buttons",
+                          G_OBJECT (button), "visible",
+                          G_BINDING_SYNC_CREATE);
+
+  return hbox;
 }
 
 
 
-/**
- **/
 void
-terminal_screen_set_size (TerminalScreen *screen,
-                          glong           width_chars,
-                          glong           height_chars)
+terminal_screen_focus (TerminalScreen *screen)
 {
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-
-  vte_terminal_set_size (VTE_TERMINAL (screen->terminal),
-                         width_chars, height_chars);
+  gtk_widget_grab_focus (GTK_WIDGET (screen->terminal));
 }
 
 
 
-void
-terminal_screen_get_geometry (TerminalScreen *screen,
-                              glong          *char_width,
-                              glong          *char_height,
-                              gint           *xpad,
-                              gint           *ypad)
+const gchar *
+terminal_screen_get_encoding (TerminalScreen *screen)
 {
-  GtkBorder border;
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  return vte_terminal_get_encoding (VTE_TERMINAL (screen->terminal));
+}
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
 
-  if (char_width != NULL)
-    *char_width = vte_terminal_get_char_width (VTE_TERMINAL (screen->terminal));
-  if (char_height != NULL)
-    *char_height = vte_terminal_get_char_height (VTE_TERMINAL (screen->terminal));
 
-  if (xpad != NULL || ypad != NULL)
-    {
-      gtk_style_context_get_padding (gtk_widget_get_style_context (screen->terminal),
-                                     gtk_widget_get_state_flags (screen->terminal),
-                                     &border);
-      if (xpad != NULL)
-        *xpad = border.left + border.right;
-      if (ypad != NULL)
-        *ypad = border.top + border.bottom;
-    }
+void
+terminal_screen_set_encoding (TerminalScreen *screen,
+                              const gchar    *charset)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  if (charset == NULL)
+    g_get_charset (&charset);
+  if (!vte_terminal_set_encoding (VTE_TERMINAL (screen->terminal), charset, NULL))
+    g_printerr (_("Failed to set encoding %s\n"), charset);
 }
 
 
 
-/**
- * terminal_screen_set_window_geometry_hints:
- *
- * I don't like this way, but its required to work-around a Gtk+
- * bug (maybe also caused by a Vte bug, not sure).
- *
- * Code for GTK > 3.19.5 borrowed from gnome-terminal
- * (terminal_window_update_geometry).
- **/
 void
-terminal_screen_set_window_geometry_hints (TerminalScreen *screen,
-                                           GtkWindow      *window)
+terminal_screen_search_set_gregex (TerminalScreen *screen,
+                                   VteRegex       *regex,
+                                   gboolean        wrap_around)
 {
-  GdkGeometry    hints;
-  glong          char_width, char_height;
-  GtkRequisition vbox_request;
-  GtkAllocation  toplevel_allocation, vbox_allocation;
-  glong          grid_width, grid_height;
-  glong          chrome_width, chrome_height;
-  gint           csd_width, csd_height;
-
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
-  terminal_return_if_fail (gtk_widget_get_realized (GTK_WIDGET (screen)));
-  terminal_return_if_fail (gtk_widget_get_realized (GTK_WIDGET (window)));
+  vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), regex, 0);
+  vte_terminal_search_set_wrap_around (VTE_TERMINAL (screen->terminal), wrap_around);
+}
 
-  terminal_screen_get_geometry (screen, &char_width, &char_height, NULL, NULL);
-  terminal_screen_get_size (screen, &grid_width, &grid_height);
 
-  gtk_widget_get_preferred_size (terminal_window_get_vbox (TERMINAL_WINDOW (window)), NULL, &vbox_request);
-  chrome_width = vbox_request.width - (char_width * grid_width);
-  chrome_height = vbox_request.height - (char_height * grid_height);
 
-  gtk_widget_get_allocation (terminal_window_get_vbox (TERMINAL_WINDOW (window)), &vbox_allocation);
-  gtk_widget_get_allocation (GTK_WIDGET (window), &toplevel_allocation);
-  csd_width = toplevel_allocation.width - vbox_allocation.width;
-  csd_height = toplevel_allocation.height - vbox_allocation.height;
+gboolean
+terminal_screen_search_has_gregex (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
+  return vte_terminal_search_get_regex (VTE_TERMINAL (screen->terminal)) != NULL;
+}
 
-  hints.base_width = chrome_width + csd_width;
-  hints.base_height = chrome_height + csd_height;
 
-  hints.width_inc = char_width;
-  hints.height_inc = char_height;
-  hints.min_width = hints.base_width + hints.width_inc * MIN_COLUMNS;
-  hints.min_height = hints.base_height + hints.height_inc * MIN_ROWS;
 
-  gtk_window_set_geometry_hints (window,
-                                 NULL,
-                                 &hints,
-                                 GDK_HINT_RESIZE_INC
-                                 | GDK_HINT_MIN_SIZE
-                                 | GDK_HINT_BASE_SIZE);
+static const TerminalSearchMatch *
+terminal_screen_search_nth (TerminalScreen *screen,
+                            guint           n)
+{
+  /* the size is a power of two */
+  return &screen->search_matches[(screen->search_head + n) & (screen->search_size - 1)];
 }
 
 
 
-/**
- * terminal_screen_force_resize_window:
- *
- * I don't like this way, but its required to work-around a Gtk+
- * bug (maybe also caused by a Vte bug, not sure).
- **/
-void
-terminal_screen_force_resize_window (TerminalScreen *screen,
-                                     GtkWindow      *window,
-                                     glong           columns,
-                                     glong           rows)
+static guint
+terminal_screen_search_count (TerminalScreen *screen)
 {
-  GtkRequisition terminal_requisition;
-  GtkRequisition vbox_requisition;
-  gint           width;
-  gint           height;
-  gint           xpad, ypad;
-  glong          char_width;
-  glong          char_height;
+  return screen->search_len;
+}
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
-  terminal_return_if_fail (GTK_IS_WINDOW (window));
 
-  terminal_screen_set_window_geometry_hints (screen, window);
 
-  gtk_widget_get_preferred_size (terminal_window_get_vbox (TERMINAL_WINDOW (window)), NULL, &vbox_requisition);
-  gtk_widget_get_preferred_size (screen->terminal, NULL, &terminal_requisition);
+static void
+terminal_screen_search_reserve (TerminalScreen *screen,
+                                guint           n_matches)
+{
+  TerminalSearchMatch *matches;
+  guint                size;
+  guint                n;
+
+  size = MAX (screen->search_size, 64);
+  while (size < screen->search_len + n_matches)
+    size *= 2;
+  if (size == screen->search_size)
+    return;
 
-  if (columns < 1)
-    columns = vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
-  if (rows < 1)
-    rows = vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal));
+  /* unwrap the ring into the new buffer */
+  matches = g_new (TerminalSearchMatch, size);
+  for (n = 0; n < screen->search_len; n++)
+    matches[n] = *terminal_screen_search_nth (screen, n);
 
-  terminal_screen_get_geometry (screen,
-                                &char_width, &char_height,
-                                &xpad, &ypad);
+  g_free (screen->search_matches);
+  screen->search_matches = matches;
+  screen->search_size = size;
+  screen->search_head = 0;
+}
 
-  width = vbox_requisition.width - terminal_requisition.width;
-  if (width < 0)
-    width = 0;
-  width += xpad + char_width * columns;
 
-  height = vbox_requisition.height - terminal_requisition.height;
-  if (height < 0)
-    height = 0;
-  height += ypad + char_height * rows;
 
-  if (gtk_widget_get_mapped (GTK_WIDGET (window)))
-    gtk_window_resize (window, width, height);
+static void
+terminal_screen_search_insert (TerminalScreen            *screen,
+                               const TerminalSearchMatch *matches,
+                               guint                      n_matches,
+                               gboolean                   prepend)
+{
+  guint mask;
+  guint n;
+
+  terminal_screen_search_reserve (screen, n_matches);
+  mask = screen->search_size - 1;
+
+  if (prepend)
+    {
+      for (n = n_matches; n > 0; n--)
+        {
+          screen->search_head = (screen->search_head - 1) & mask;
+          screen->search_matches[screen->search_head] = matches[n - 1];
+        }
+    }
   else
-    gtk_window_set_default_size (window, width, height);
+    {
+      for (n = 0; n < n_matches; n++)
+        screen->search_matches[(screen->search_head + screen->search_len + n) & mask] = matches[n];
+    }
+
+  screen->search_len += n_matches;
 }
 
 
 
-/**
- * terminal_screen_get_title:
- * @screen      : A #TerminalScreen.
- *
- * Return value : The title to set for this terminal screen.
- *                The returned string should be freed when
- *                no longer needed.
- **/
-gchar*
-terminal_screen_get_title (TerminalScreen *screen)
+/* keeps the matches from first up to last */
+static void
+terminal_screen_search_truncate (TerminalScreen *screen,
+                                 guint           first,
+                                 guint           last)
 {
-  TerminalTitle  mode;
-  const gchar   *vte_title;
-  gchar         *initial, *tmp;
-  gchar         *title;
+  terminal_assert (first <= last && last <= screen->search_len);
 
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  if (screen->search_size == 0)
+    return;
 
-  if (G_UNLIKELY (screen->custom_title != NULL))
-    return terminal_screen_parse_title (screen, screen->custom_title);
+  screen->search_head = (screen->search_head + first) & (screen->search_size - 1);
+  screen->search_len = last - first;
+}
 
-  vte_title = vte_terminal_get_window_title (VTE_TERMINAL (screen->terminal));
 
-  if (G_UNLIKELY (screen->initial_title != NULL))
-    initial = terminal_screen_parse_title (screen, screen->initial_title);
-  else
-    {
-      g_object_get (G_OBJECT (screen->preferences), "title-initial", &tmp, NULL);
-      initial = terminal_screen_parse_title (screen, tmp);
-      g_free (tmp);
-    }
 
-  if (G_UNLIKELY (screen->dynamic_title_mode != TERMINAL_TITLE_DEFAULT))
-    mode = screen->dynamic_title_mode;
-  else
-    g_object_get (G_OBJECT (screen->preferences), "title-mode", &mode, NULL);
+/* index of the first match at or after row and column */
+static guint
+terminal_screen_search_lookup (TerminalScreen *screen,
+                               glong           row,
+                               gint            col)
+{
+  const TerminalSearchMatch *match;
+  guint                      lo = 0;
+  guint                      hi = terminal_screen_search_count (screen);
+  guint                      mid;
 
-  switch (mode)
+  while (lo < hi)
     {
-    case TERMINAL_TITLE_REPLACE:
-      if (G_LIKELY (vte_title != NULL))
-        title = g_strdup (vte_title);
-      else if (initial != NULL)
-        return initial;
+      mid = (lo + hi) / 2;
+      match = terminal_screen_search_nth (screen, mid);
+      if (match->row < row || (match->row == row && match->start_col < col))
+        lo = mid + 1;
       else
-        title = g_strdup (_("Untitled"));
-      break;
+        hi = mid;
+    }
 
-    case TERMINAL_TITLE_PREPEND:
-      if (G_LIKELY (vte_title != NULL))
-        title = g_strconcat (vte_title, " - ", initial, NULL);
-      else
-        return initial;
-      break;
+  return lo;
+}
 
-    case TERMINAL_TITLE_APPEND:
-      if (G_LIKELY (vte_title != NULL))
-        title = g_strconcat (initial, " - ", vte_title, NULL);
-      else
-        return initial;
-      break;
 
-    case TERMINAL_TITLE_HIDE:
-      return initial;
-      break;
 
-    default:
-      terminal_assert_not_reached ();
-      title = NULL;
-    }
+static void
+terminal_screen_search_changed (TerminalScreen *screen)
+{
+  if (screen->search_highlight != NULL)
+    gtk_widget_queue_draw (screen->search_highlight);
 
-  g_free (initial);
+  g_object_freeze_notify (G_OBJECT (screen));
+  g_object_notify (G_OBJECT (screen), "search-matches");
+  g_object_notify (G_OBJECT (screen), "search-match");
+  g_object_thaw_notify (G_OBJECT (screen));
+}
 
-  return title;
+
+
+static void
+terminal_screen_search_set_current (TerminalScreen            *screen,
+                                    const TerminalSearchMatch *match)
+{
+  screen->search_current = *match;
+  screen->search_has_current = TRUE;
 }
 
 
 
-/**
- * terminal_screen_get_working_directory:
- * @screen      : A #TerminalScreen.
- *
- * Determinies the working directory using various OS-specific mechanisms.
- *
- * Return value : The current working directory of @screen.
- **/
-const gchar*
-terminal_screen_get_working_directory (TerminalScreen *screen)
+static gboolean
+terminal_screen_search_draw (GtkWidget      *area,
+                             cairo_t        *cr,
+                             TerminalScreen *screen)
 {
-  gchar        buffer[4096 + 1];
-  gchar       *file;
-  gchar       *cwd;
-  const gchar *uri;
-  gint         length;
+  const TerminalSearchMatch *match;
+  GtkAdjustment             *adjustment;
+  GtkStyleContext           *context;
+  GtkBorder                  padding;
+  gdouble                    top, bottom;
+  glong                      char_width, char_height;
+  glong                      columns;
+  glong                      row;
+  gint                       x, y;
+  gint                       col, width, remaining;
+  guint                      n, n_matches;
+
+  n_matches = terminal_screen_search_count (screen);
+  if (n_matches == 0)
+    return FALSE;
 
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  top = gtk_adjustment_get_value (adjustment);
+  bottom = top + gtk_adjustment_get_page_size (adjustment);
 
-  /* try to use vte functionality first: see bug #13902 */
-  uri = vte_terminal_get_current_directory_uri (VTE_TERMINAL (screen->terminal));
-  if (uri != NULL)
-    {
-      g_free (screen->working_directory);
-      screen->working_directory = g_filename_from_uri (uri, NULL, NULL);
-    }
-  else if (screen->pid >= 0)
+  char_width = vte_terminal_get_char_width (VTE_TERMINAL (screen->terminal));
+  char_height = vte_terminal_get_char_height (VTE_TERMINAL (screen->terminal));
+  columns = vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
+
+  /* origin of the cell grid in the overlay */
+  if (!gtk_widget_translate_coordinates (screen->terminal, area, 0, 0, &x, &y))
+    return FALSE;
+  context = gtk_widget_get_style_context (screen->terminal);
+  gtk_style_context_get_padding (context, gtk_widget_get_state_flags (screen->terminal), &padding);
+  x += padding.left;
+  y += padding.top;
+
+  /* only the rows in the view, found with a binary search; the match
+   * before them can continue on the top row */
+  n = terminal_screen_search_lookup (screen, (glong) top, 0);
+  for (n = n > 0 ? n - 1 : 0; n < n_matches; n++)
     {
-      /* make sure that we use linprocfs on all systems */
-#if defined(__FreeBSD__)
-      file = g_strdup_printf ("/compat/linux/proc/%d/cwd", screen->pid);
-#elif defined(__NetBSD__) || defined(__OpenBSD__)
-      file = g_strdup_printf ("/emul/linux/proc/%d/cwd", screen->pid);
-#else
-      file = g_strdup_printf ("/proc/%d/cwd", screen->pid);
-#endif
+      match = terminal_screen_search_nth (screen, n);
+      if (match->row >= bottom)
+        break;
 
-      length = readlink (file, buffer, sizeof (buffer) - 1);
-      if (length > 0 && *buffer == '/')
-        {
-          buffer[length] = '\0';
-          g_free (screen->working_directory);
-          screen->working_directory = g_strdup (buffer);
-        }
-      else if (length == 0)
-        {
-          cwd = g_get_current_dir ();
-          if (G_LIKELY (cwd != NULL))
-            {
-              if (chdir (file) == 0)
-                {
-                  g_free (screen->working_directory);
-                  screen->working_directory = g_get_current_dir ();
-                  if (chdir (cwd) == 0) {};
-                }
+      if (screen->search_has_current
+          && match->row == screen->search_current.row
+          && match->start_col == screen->search_current.start_col)
+        cairo_set_source_rgba (cr, 1.0, 0.5, 0.0, 0.5);
+      else
+        cairo_set_source_rgba (cr, 1.0, 1.0, 0.0, 0.3);
 
-              g_free (cwd);
-            }
+      /* a match on soft wrapped rows ends past the last column */
+      row = match->row;
+      col = match->start_col;
+      for (remaining = match->end_col - match->start_col; remaining > 0; remaining -= width)
+        {
+          width = MIN (remaining, columns - col);
+          if (width <= 0)
+            break;
+
+          cairo_rectangle (cr,
+                           x + col * char_width,
+                           y + (row - top) * char_height,
+                           width * char_width,
+                           char_height);
+          row++;
+          col = 0;
         }
-
-      g_free (file);
+      cairo_fill (cr);
     }
 
-  return screen->working_directory;
+  return FALSE;
 }
 
 
 
-/**
- * terminal_screen_set_working_directory:
- * @screen    : A #TerminalScreen.
- * @directory :
- **/
-void
-terminal_screen_set_working_directory (TerminalScreen *screen,
-                                       const gchar    *directory)
+static void
+terminal_screen_search_scanned (const TerminalSearchMatch *matches,
+                                guint                      n_matches,
+                                gboolean                   finished,
+                                gpointer                   user_data)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  terminal_return_if_fail (directory != NULL);
+  TerminalScreen            *screen = TERMINAL_SCREEN (user_data);
+  const TerminalSearchMatch *nearest;
+  GtkAdjustment             *adjustment;
+  glong                      top;
+  guint                      n;
 
-  g_free (screen->working_directory);
-  screen->working_directory = g_strdup (directory);
-}
+  if (finished)
+    {
+      /* the scan releases itself after this */
+      screen->search_scan = NULL;
 
+      /* output arrived during the scan */
+      if (screen->search_dirty)
+        terminal_screen_search_queue_update (screen);
+      return;
+    }
 
+  /* add the chunk as a whole, chunks above the origin arrive upwards */
+  terminal_screen_search_insert (screen, matches, n_matches,
+                                 matches[0].row < screen->search_origin);
 
-/**
- * terminal_screen_has_selection:
- * @screen      : A #TerminalScreen.
- *
- * Checks if the terminal currently contains selected text. Note that this is different from
- * determining if the terminal is the owner of any GtkClipboard items.
- *
- * Return value : %TRUE if part of the text in the terminal is selected.
- **/
-gboolean
-terminal_screen_has_selection (TerminalScreen *screen)
-{
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-  return vte_terminal_get_has_selection (VTE_TERMINAL (screen->terminal));
+  /* only the first results move the view, later ones are further away */
+  if (!screen->search_jumped)
+    {
+      screen->search_jumped = TRUE;
+
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+      top = gtk_adjustment_get_value (adjustment);
+
+      nearest = &matches[0];
+      for (n = 1; n < n_matches; n++)
+        if (ABS (matches[n].row - top) < ABS (nearest->row - top))
+          nearest = &matches[n];
+      terminal_screen_search_set_current (screen, nearest);
+
+      /* scroll the match into the view, the highlight marks it and a
+       * selection of vte would be at another match */
+      if (nearest->row < top || nearest->row >= top + gtk_adjustment_get_page_size (adjustment))
+        gtk_adjustment_set_value (adjustment, nearest->row);
+      vte_terminal_unselect_all (VTE_TERMINAL (screen->terminal));
+    }
+
+  terminal_screen_search_changed (screen);
 }
 
 
 
-/**
- * terminal_screen_copy_clipboard:
- * @screen  : A #TerminalScreen.
- *
- * Places the selected text in the terminal in the #GDK_SELECTION_CLIPBOARD selection.
- **/
-void
-terminal_screen_copy_clipboard (TerminalScreen *screen)
+static void
+terminal_screen_search_rescan (TerminalScreen *screen)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-#if VTE_CHECK_VERSION (0, 49, 2)
-  vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_TEXT);
-#else
-  vte_terminal_copy_clipboard (VTE_TERMINAL (screen->terminal));
-#endif
-}
-
+  GtkAdjustment *adjustment;
+  glong          upper;
 
+  if (screen->search_scan != NULL)
+    {
+      terminal_search_scan_cancel (screen->search_scan);
+      screen->search_scan = NULL;
+    }
 
-/**
- * terminal_screen_copy_clipboard_html:
- * @screen  : A #TerminalScreen.
- *
- * Places the selected text in the terminal in the #GDK_SELECTION_CLIPBOARD selection
- * as HTML (preserving colors, bold font, etc).
- **/
-#if VTE_CHECK_VERSION (0, 49, 2)
-void
-terminal_screen_copy_clipboard_html (TerminalScreen *screen)
-{
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_HTML);
+  terminal_screen_search_truncate (screen, 0, 0);
+  screen->search_has_current = FALSE;
+  screen->search_jumped = FALSE;
+  screen->search_dirty = FALSE;
+
+  /* the rows of the screen area can still change, everything before
+   * it is final and never scanned again */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  upper = gtk_adjustment_get_upper (adjustment);
+  screen->search_origin = terminal_search_get_line_start (VTE_TERMINAL (screen->terminal),
+                                                          gtk_adjustment_get_value (adjustment));
+  screen->search_indexed = MAX ((glong) gtk_adjustment_get_lower (adjustment),
+                                upper - vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal)));
+
+  screen->search_scan = terminal_search_scan_start (VTE_TERMINAL (screen->terminal),
+                                                    screen->search_regex,
+                                                    G_MINLONG, screen->search_origin,
+                                                    terminal_screen_search_scanned, screen);
+
+  terminal_screen_search_changed (screen);
 }
-#endif
 
 
 
-/**
- * terminal_screen_paste_clipboard:
- * @screen  : A #TerminalScreen.
- *
- * Sends the contents of the #GDK_SELECTION_CLIPBOARD selection to the terminal's
- * child. If neccessary, the data is converted from UTF-8 to the terminal's current
- * encoding.
- **/
-void
-terminal_screen_paste_clipboard (TerminalScreen *screen)
+static gboolean
+terminal_screen_search_update (gpointer user_data)
 {
-  gboolean  show_dialog;
-  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_CLIPBOARD));
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  GtkAdjustment  *adjustment;
+  glong           lower, upper;
+  glong           first;
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  screen->search_update_id = 0;
 
-  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
+  if (screen->search_regex == NULL)
+    return FALSE;
 
-  if (show_dialog && terminal_screen_is_text_unsafe (text))
-    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_CLIPBOARD);
-  else
-    vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
+  /* the index is updated after the running scan */
+  if (screen->search_scan != NULL)
+    {
+      screen->search_dirty = TRUE;
+      return FALSE;
+    }
+  screen->search_dirty = FALSE;
 
-  g_free (text);
-}
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  lower = gtk_adjustment_get_lower (adjustment);
+  upper = gtk_adjustment_get_upper (adjustment);
 
+  /* the terminal was reset */
+  if (upper < screen->search_indexed)
+    {
+      terminal_screen_search_rescan (screen);
+      return FALSE;
+    }
 
+  /* drop the matches of rows that left the scrollback and of the
+   * screen area, which is scanned again with the rows below it */
+  first = terminal_search_get_line_start (VTE_TERMINAL (screen->terminal),
+                                          MAX (screen->search_indexed, lower));
+  terminal_screen_search_truncate (screen,
+                                   terminal_screen_search_lookup (screen, lower, 0),
+                                   terminal_screen_search_lookup (screen, first, 0));
 
-/**
- * terminal_screen_paste_primary:
- * @screen : A #TerminalScreen.
- *
- * Sends the contents of the #GDK_SELECTION_PRIMARY selection to the terminal's child.
- * If necessary, the data is converted from UTF-8 to the terminal's current encoding.
- * The terminal will call also paste the #GDK_SELECTION_PRIMARY selection when the user
- * clicks with the the second mouse button.
- **/
-void
-terminal_screen_paste_primary (TerminalScreen *screen)
-{
-  gboolean  show_dialog;
-  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_PRIMARY));
+  /* all the new matches go at the end */
+  screen->search_origin = first;
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  screen->search_indexed = MAX (lower, upper - vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal)));
+  screen->search_scan = terminal_search_scan_start (VTE_TERMINAL (screen->terminal),
+                                                    screen->search_regex,
+                                                    first, first,
+                                                    terminal_screen_search_scanned, screen);
 
-  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
+  terminal_screen_search_changed (screen);
 
-  if (show_dialog && terminal_screen_is_text_unsafe (text))
-    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_PRIMARY);
-  else
-    vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
+  return FALSE;
+}
 
-  g_free (text);
+
+
+static void
+terminal_screen_search_queue_update (TerminalScreen *screen)
+{
+  if (screen->search_update_id == 0)
+    {
+      screen->search_update_id =
+          terminal_timer_add (TERMINAL_WAKEUP_SEARCH, SEARCH_UPDATE_INTERVAL,
+                              terminal_screen_search_update, screen, NULL);
+    }
 }
 
 
 
 /**
- * terminal_screen_select_all:
- * @screen : A #TerminalScreen.
+ * terminal_screen_search_incremental:
+ * @screen      : A #TerminalScreen.
+ * @regex       : The #VteRegex for vte or %NULL to clear the search.
+ * @scan_regex  : The same expression as #GRegex or %NULL.
+ * @wrap_around : Whether find next and previous wrap around.
+ * @jump        : Whether to move to the match nearest to the view.
  *
- * Selects all text in the terminal.
+ * Sets the search expression while it is being typed and indexes the
+ * matches in the scrollback in the background, with @jump the view
+ * moves to the match nearest to it as soon as the first one is found.
+ * The index is kept up to date with new output until
+ * terminal_screen_search_clear_matches() and all the matches in the
+ * view are highlighted. An index of the same expression is kept.
  **/
 void
-terminal_screen_select_all (TerminalScreen *screen)
+terminal_screen_search_incremental (TerminalScreen *screen,
+                                    VteRegex       *regex,
+                                    GRegex         *scan_regex,
+                                    gboolean        wrap_around,
+                                    gboolean        jump)
 {
+  GtkAdjustment *adjustment;
+
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_select_all (VTE_TERMINAL (screen->terminal));
-}
 
+  terminal_screen_search_set_gregex (screen, regex, wrap_around);
 
+  if (regex == NULL || scan_regex == NULL)
+    {
+      terminal_screen_search_clear_matches (screen);
+      vte_terminal_unselect_all (VTE_TERMINAL (screen->terminal));
+      return;
+    }
 
-/**
- * terminal_screen_reset:
- * @screen  : A #TerminalScreen.
- * @clear   : %TRUE to also clear the terminal screen.
- *
- * Resets the terminal.
- **/
-void
-terminal_screen_reset (TerminalScreen *screen,
-                       gboolean        clear)
-{
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_reset (VTE_TERMINAL (screen->terminal), TRUE, clear);
+  if (screen->search_regex != NULL
+      && g_regex_get_compile_flags (screen->search_regex) == g_regex_get_compile_flags (scan_regex)
+      && g_strcmp0 (g_regex_get_pattern (screen->search_regex), g_regex_get_pattern (scan_regex)) == 0)
+    return;
 
-  if (clear)
-    vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), NULL, 0);
+  if (screen->search_regex != NULL)
+    g_regex_unref (screen->search_regex);
+  screen->search_regex = g_regex_ref (scan_regex);
+
+  terminal_screen_search_reserve (screen, 0);
+
+  if (screen->search_highlight == NULL)
+    {
+      screen->search_highlight = gtk_drawing_area_new ();
+      gtk_overlay_add_overlay (GTK_OVERLAY (screen), screen->search_highlight);
+      gtk_overlay_set_overlay_pass_through (GTK_OVERLAY (screen), screen->search_highlight, TRUE);
+      g_signal_connect (G_OBJECT (screen->search_highlight), "draw",
+          G_CALLBACK (terminal_screen_search_draw), screen);
+      gtk_widget_show (screen->search_highlight);
+
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+      g_signal_connect_object (G_OBJECT (adjustment), "value-changed",
+          G_CALLBACK (gtk_widget_queue_draw), screen->search_highlight, G_CONNECT_SWAPPED);
+    }
+
+  terminal_screen_search_rescan (screen);
+  screen->search_jumped = !jump;
 }
 
 
 
 /**
- * terminal_screen_get_restart_command:
- * @screen  : A #TerminalScreen.
+ * terminal_screen_search_clear_matches:
+ * @screen : A #TerminalScreen.
  *
- * Return value: Command to restore @screen, arguments are in reversed order.
+ * Stops indexing the matches of the search and removes the highlights,
+ * the search expression is kept for find next and previous.
  **/
-GSList*
-terminal_screen_get_restart_command (TerminalScreen *screen)
+void
+terminal_screen_search_clear_matches (TerminalScreen *screen)
 {
-  const gchar *directory;
-  GSList      *result = NULL;
+  GtkAdjustment *adjustment;
 
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
-  if (screen->custom_command != NULL)
+  if (screen->search_scan != NULL)
     {
-      result = g_slist_prepend (result, g_strdup ("-e"));
-      result = g_slist_prepend (result, g_strjoinv (" ", screen->custom_command));
+      terminal_search_scan_cancel (screen->search_scan);
+      screen->search_scan = NULL;
     }
 
-  if (screen->custom_title != NULL)
+  if (screen->search_update_id != 0)
     {
-      result = g_slist_prepend (result, g_strdup ("--title"));
-      result = g_slist_prepend (result, g_strdup (screen->custom_title));
+      terminal_timer_remove (screen->search_update_id);
+      screen->search_update_id = 0;
     }
 
-  directory = terminal_screen_get_working_directory (screen);
-  if (G_LIKELY (directory != NULL))
+  if (screen->search_highlight != NULL)
     {
-      result = g_slist_prepend (result, g_strdup ("--working-directory"));
-      result = g_slist_prepend (result, g_strdup (directory));
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+      g_signal_handlers_disconnect_by_func (G_OBJECT (adjustment),
+          G_CALLBACK (gtk_widget_queue_draw), screen->search_highlight);
+      gtk_widget_destroy (screen->search_highlight);
+      screen->search_highlight = NULL;
     }
 
-  if (G_UNLIKELY (screen->hold))
-    result = g_slist_prepend (result, g_strdup ("--hold"));
+  if (screen->search_regex != NULL)
+    {
+      g_regex_unref (screen->search_regex);
+      screen->search_regex = NULL;
+    }
 
-  return result;
+  if (screen->search_matches != NULL)
+    {
+      g_free (screen->search_matches);
+      screen->search_matches = NULL;
+      screen->search_size = 0;
+      screen->search_head = 0;
+      screen->search_len = 0;
+      screen->search_has_current = FALSE;
+
+      terminal_screen_search_changed (screen);
+    }
 }
 
 
 
-void
-terminal_screen_reset_activity (TerminalScreen *screen)
+/**
+ * terminal_screen_search_get_matches:
+ * @screen  : A #TerminalScreen.
+ * @current : Return location for the position of the current match,
+ *            starting at 1, or 0 if unknown.
+ * @total   : Return location for the number of matches found so far.
+ *
+ * Return value : %FALSE if the matches of the search are not indexed.
+ **/
+gboolean
+terminal_screen_search_get_matches (TerminalScreen *screen,
+                                    guint          *current,
+                                    guint          *total)
 {
-  GdkRGBA label_color;
+  const TerminalSearchMatch *match;
+  guint                      n;
 
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
 
-  if (screen->activity_timeout_id != 0)
-    g_source_remove (screen->activity_timeout_id);
+  *current = 0;
+  *total = terminal_screen_search_count (screen);
 
-  if (screen->tab_label != NULL)
+  if (screen->search_matches == NULL)
+    return FALSE;
+
+  if (screen->search_has_current)
     {
-      if (G_LIKELY (screen->custom_title_color == NULL))
-        gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
-      else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
-        terminal_screen_set_tab_label_color (screen, &label_color);
+      n = terminal_screen_search_lookup (screen, screen->search_current.row,
+                                         screen->search_current.start_col);
+      if (n < *total)
+        {
+          match = terminal_screen_search_nth (screen, n);
+          if (match->row == screen->search_current.row
+              && match->start_col == screen->search_current.start_col)
+            *current = n + 1;
+        }
     }
-}
-
 
-
-static void
-terminal_screen_close_tab_cb (TerminalScreen *screen)
-{
-  g_signal_emit (G_OBJECT (screen), screen_signals[CLOSE_TAB], 0);
+  return TRUE;
 }
 
 
 
-GtkWidget *
-terminal_screen_get_tab_label (TerminalScreen *screen)
+static void
+terminal_screen_search_step (TerminalScreen *screen,
+                             gboolean        forward)
 {
-  GtkWidget *hbox, *button, *image;
-
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
-
-  /* create the box */
-  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-  gtk_container_set_border_width (GTK_CONTAINER (hbox), 2);
-
-  screen->tab_label = gtk_label_new (NULL);
-  gtk_widget_set_margin_start (screen->tab_label, 2);
-  gtk_box_pack_start  (GTK_BOX (hbox), screen->tab_label, TRUE, TRUE, 0);
-  g_object_bind_property (G_OBJECT (screen), "title",
-                          G_OBJECT (screen->tab_label), "label",
-                          G_BINDING_SYNC_CREATE);
-  g_object_bind_property (G_OBJECT (screen->tab_label), "label",
-                          G_OBJECT (screen->tab_label), "tooltip-text",
-                          G_BINDING_SYNC_CREATE);
-  gtk_widget_set_has_tooltip (screen->tab_label, TRUE);
-
-  button = gtk_button_new ();
-  gtk_widget_set_focus_on_click (button, FALSE);
-  gtk_button_set_relief (GTK_BUTTON (button), GTK_RELIEF_NONE);
-  gtk_widget_set_can_focus (button, FALSE);
-  gtk_widget_set_can_default (button, FALSE);
-  gtk_widget_set_tooltip_text (button, _("Close this tab"));
-  gtk_widget_set_halign (button, GTK_ALIGN_CENTER);
-  gtk_widget_set_valign (button, GTK_ALIGN_CENTER);
-  gtk_container_add (GTK_CONTAINER (hbox), button);
-  g_signal_connect_swapped (G_OBJECT (button), "clicked",
-                            G_CALLBACK (terminal_screen_close_tab_cb), screen);
+  const TerminalSearchMatch *match;
+  GtkAdjustment             *adjustment;
+  guint                      n_matches;
+  guint                      n;
 
-  /* button image */
-  image = gtk_image_new_from_icon_name ("window-close-symbolic", GTK_ICON_SIZE_MENU);
-  gtk_container_add (GTK_CONTAINER (button), image);
+  n_matches = terminal_screen_search_count (screen);
+  if (n_matches == 0)
+    return;
 
-  /* show the box and all its widgets */
-  gtk_widget_show_all (hbox);
+  /* same as vte, without a current match start in the view */
+  if (screen->search_has_current)
+    {
+      n = terminal_screen_search_lookup (screen, screen->search_current.row,
+                                         screen->search_current.start_col);
+      if (forward && n < n_matches)
+        {
+          match = terminal_screen_search_nth (screen, n);
+          if (match->row == screen->search_current.row
+              && match->start_col == screen->search_current.start_col)
+            n++;
+        }
+    }
+  else
+    {
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+      n = terminal_screen_search_lookup (screen, gtk_adjustment_get_value (adjustment), 0);
+    }
 
-  /* update orientation */
-  terminal_screen_update_label_orientation (screen);
+  if (forward && n >= n_matches)
+    {
+      if (!vte_terminal_search_get_wrap_around (VTE_TERMINAL (screen->terminal)))
+        return;
+      n = 0;
+    }
+  else if (!forward)
+    {
+      if (n == 0)
+        {
+          if (!vte_terminal_search_get_wrap_around (VTE_TERMINAL (screen->terminal)))
+            return;
+          n = n_matches;
+        }
+      n--;
+    }
 
-  /* respect the show/hide buttons option */
-  g_object_bind_property (G_OBJECT (screen->preferences), "misc-tab-close-buttons",
-                          G_OBJECT (button), "visible",
-                          G_BINDING_SYNC_CREATE);
+  match = terminal_screen_search_nth (screen, n);
+  terminal_screen_search_set_current (screen, match);
+  terminal_screen_search_changed (screen);
 
-  return hbox;
+  /* the highlight marks the match, not the selection of vte */
+  terminal_screen_scroll_to_row (screen, match->row);
+  vte_terminal_unselect_all (VTE_TERMINAL (screen->terminal));
 }
 
 
 
-void
-terminal_screen_focus (TerminalScreen *screen)
+/**
+ * terminal_screen_search_scan:
+ * @screen    : A #TerminalScreen.
+ * @regex     : The #GRegex to search for.
+ * @func      : Function called with the matches of each chunk.
+ * @user_data : Data passed to @func.
+ *
+ * Scans the whole scrollback of @screen from the top, independent of
+ * the search of the screen. The matches carry the text of their row.
+ *
+ * Return value : The running scan, see terminal_search_scan_start().
+ **/
+TerminalSearchScan *
+terminal_screen_search_scan (TerminalScreen     *screen,
+                             GRegex             *regex,
+                             TerminalSearchFunc  func,
+                             gpointer            user_data)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  gtk_widget_grab_focus (GTK_WIDGET (screen->terminal));
-}
-
+  TerminalSearchScan *scan;
 
-
-const gchar *
-terminal_screen_get_encoding (TerminalScreen *screen)
-{
   terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
-  return vte_terminal_get_encoding (VTE_TERMINAL (screen->terminal));
-}
 
+  scan = terminal_search_scan_start (VTE_TERMINAL (screen->terminal), regex,
+                                     G_MINLONG, G_MINLONG, func, user_data);
+  terminal_search_scan_set_previews (scan, TRUE);
 
-
-void
-terminal_screen_set_encoding (TerminalScreen *screen,
-                              const gchar    *charset)
-{
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  if (charset == NULL)
-    g_get_charset (&charset);
-  if (!vte_terminal_set_encoding (VTE_TERMINAL (screen->terminal), charset, NULL))
-    g_printerr (_("Failed to set encoding %s\n"), charset);
+  return scan;
 }
 
 
 
+/**
+ * terminal_screen_scroll_to_row:
+ * @screen : A #TerminalScreen.
+ * @row    : A row of the scrollback.
+ *
+ * Scrolls @row into the view, if it is not visible already.
+ **/
 void
-terminal_screen_search_set_gregex (TerminalScreen *screen,
-                                   VteRegex       *regex,
-                                   gboolean        wrap_around)
+terminal_screen_scroll_to_row (TerminalScreen *screen,
+                               glong           row)
 {
-  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), regex, 0);
-  vte_terminal_search_set_wrap_around (VTE_TERMINAL (screen->terminal), wrap_around);
-}
-
+  GtkAdjustment *adjustment;
+  gdouble        top;
 
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
-gboolean
-terminal_screen_search_has_gregex (TerminalScreen *screen)
-{
-  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-  return vte_terminal_search_get_regex (VTE_TERMINAL (screen->terminal)) != NULL;
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  top = gtk_adjustment_get_value (adjustment);
+  if (row < top || row >= top + gtk_adjustment_get_page_size (adjustment))
+    gtk_adjustment_set_value (adjustment, row);
 }
 
 
 
+/**
+ * terminal_screen_search_find_next:
+ * @screen : A #TerminalScreen.
+ *
+ * Moves to the next match of the index, so the position reported by
+ * terminal_screen_search_get_matches() is the one in the view. Vte
+ * does not tell where its selection is, so it only searches when
+ * there is no index.
+ **/
 void
 terminal_screen_search_find_next (TerminalScreen *screen)
 {
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_find_next (VTE_TERMINAL (screen->terminal));
+
+  if (terminal_screen_search_count (screen) > 0)
+    terminal_screen_search_step (screen, TRUE);
+  else
+    vte_terminal_search_find_next (VTE_TERMINAL (screen->terminal));
 }
 
 
@@ -2739,7 +4674,11 @@ void
 terminal_screen_search_find_previous (TerminalScreen *screen)
 {
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_find_previous (VTE_TERMINAL (screen->terminal));
+
+  if (terminal_screen_search_count (screen) > 0)
+    terminal_screen_search_step (screen, FALSE);
+  else
+    vte_terminal_search_find_previous (VTE_TERMINAL (screen->terminal));
 }
 
 
@@ -2804,10 +4743,9 @@ terminal_screen_update_font (TerminalScreen *screen)
   GtkWidget            *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
   gboolean              font_use_system, font_allow_bold;
   gchar                *font_name = NULL;
-  PangoFontDescription *font_desc;
+  PangoFontDescription *font_desc = NULL;
+  const gchar          *window_font = NULL;
   glong                 grid_w = 0, grid_h = 0;
-  GSettings            *settings;
-  XfconfChannel        *channel;
   gdouble               font_scale = PANGO_SCALE_MEDIUM;
 #if VTE_CHECK_VERSION (0, 51, 3)
   gdouble cell_width_scale, cell_height_scale;
@@ -2817,39 +4755,23 @@ terminal_screen_update_font (TerminalScreen *screen)
   terminal_return_if_fail (TERMINAL_IS_PREFERENCES (screen->preferences));
   terminal_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
 
+  /* changing the font of a tab means a new size and relayout, tabs
+   * that are not visible do that in terminal_screen_set_hidden() */
+  if (screen->hidden)
+    {
+      screen->font_dirty = TRUE;
+      return;
+    }
+  screen->font_dirty = FALSE;
+
   g_object_get (G_OBJECT (screen->preferences),
                 "font-use-system", &font_use_system,
                 "font-allow-bold", &font_allow_bold,
                 NULL);
 
-  if (font_use_system)
-    {
-      /* read Xfce settings */
-      xfconf_init (NULL);
-      channel = xfconf_channel_get ("xsettings");
-      if (xfconf_channel_has_property (channel, "/Gtk/MonospaceFontName"))
-        font_name = xfconf_channel_get_string (channel, "/Gtk/MonospaceFontName", "");
-      xfconf_shutdown ();
-
-      /* if font isn't set, read GNOME settings */
-      if (!IS_STRING (font_name))
-        {
-          g_free (font_name);
-          settings = g_settings_new ("org.gnome.desktop.interface");
-          font_name = g_settings_get_string (settings, "monospace-font-name");
-          g_object_unref (settings);
-        }
-    }
-  else
-    g_object_get (G_OBJECT (screen->preferences), "font-name", &font_name, NULL);
-
   if (TERMINAL_IS_WINDOW (toplevel))
     {
-      if (terminal_window_get_font (TERMINAL_WINDOW (toplevel)))
-        {
-          g_free (font_name);
-          font_name = g_strdup (terminal_window_get_font (TERMINAL_WINDOW (toplevel)));
-        }
+      window_font = terminal_window_get_font (TERMINAL_WINDOW (toplevel));
 
       switch (terminal_window_get_zoom_level (TERMINAL_WINDOW (toplevel)))
         {
@@ -2874,14 +4796,28 @@ terminal_screen_update_font (TerminalScreen *screen)
   if (gtk_widget_get_realized (GTK_WIDGET (screen)))
     terminal_screen_get_size (screen, &grid_w, &grid_h);
 
-  if (G_LIKELY (font_name != NULL))
+  if (window_font != NULL)
+    font_desc = pango_font_description_from_string (window_font);
+  else if (font_use_system)
+    {
+      /* resolved and watched once by the app */
+      if (terminal_app_get_system_font () != NULL)
+        font_desc = pango_font_description_copy (terminal_app_get_system_font ());
+    }
+  else
+    {
+      g_object_get (G_OBJECT (screen->preferences), "font-name", &font_name, NULL);
+      if (G_LIKELY (font_name != NULL))
+        font_desc = pango_font_description_from_string (font_name);
+      g_free (font_name);
+    }
+
+  if (G_LIKELY (font_desc != NULL))
     {
-      font_desc = pango_font_description_from_string (font_name);
       vte_terminal_set_allow_bold (VTE_TERMINAL (screen->terminal), font_allow_bold);
       vte_terminal_set_font (VTE_TERMINAL (screen->terminal), font_desc);
       vte_terminal_set_font_scale (VTE_TERMINAL (screen->terminal), font_scale);
       pango_font_description_free (font_desc);
-      g_free (font_name);
     }
 
 #if VTE_CHECK_VERSION (0, 51, 3)
@@ -2924,11 +4860,7 @@ gboolean
 terminal_screen_get_scroll_on_output (TerminalScreen *screen)
 {
   terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-#if !VTE_CHECK_VERSION (0, 51, 1)
   return screen->scroll_on_output;
-#else
-  return vte_terminal_get_scroll_on_output (VTE_TERMINAL (screen->terminal));
-#endif
 }
 
 
@@ -2938,10 +4870,63 @@ terminal_screen_set_scroll_on_output (TerminalScreen *screen,
                                       gboolean        enabled)
 {
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-#if !VTE_CHECK_VERSION (0, 51, 1)
   screen->scroll_on_output = enabled;
+
+  /* a hidden screen catches up in terminal_screen_set_hidden() */
+  vte_terminal_set_scroll_on_output (VTE_TERMINAL (screen->terminal), enabled && !screen->hidden);
+}
+
+
+
+/**
+ * terminal_screen_set_hidden:
+ * @screen : A #TerminalScreen.
+ * @hidden : Whether the screen is out of sight.
+ *
+ * Marks @screen as hidden when it is not the visible notebook page or
+ * its window is iconified. Hidden screens stop cursor and text blinking
+ * and do not scroll on output, which saves redraws of terminals nobody
+ * is looking at.
+ **/
+void
+terminal_screen_set_hidden (TerminalScreen *screen,
+                            gboolean        hidden)
+{
+  GtkAdjustment *adjustment;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (screen->hidden == hidden)
+    return;
+
+  screen->hidden = hidden;
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Screen %u is %s", screen->session_id, hidden ? "hidden" : "visible");
 #endif
-  vte_terminal_set_scroll_on_output (VTE_TERMINAL (screen->terminal), enabled);
+
+  terminal_screen_update_misc_cursor_blinks (screen);
+  terminal_screen_update_text_blink_mode (screen);
+  terminal_screen_set_scroll_on_output (screen, screen->scroll_on_output);
+
+  if (!hidden && screen->font_dirty)
+    terminal_screen_update_font (screen);
+
+  /* show a pending title on the next frame */
+  if (!hidden && screen->title_timer_id != 0)
+    {
+      terminal_timer_remove (screen->title_timer_id);
+      screen->title_timer_id = 0;
+      terminal_screen_queue_title_update (screen);
+    }
+
+  /* jump to the output that arrived while hidden */
+  if (!hidden && screen->scroll_on_output)
+    {
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+      gtk_adjustment_set_value (adjustment, gtk_adjustment_get_upper (adjustment)
+                                            - gtk_adjustment_get_page_size (adjustment));
+    }
 }
 
 
@@ -2967,26 +4952,23 @@ terminal_screen_save_contents (TerminalScreen *screen,
 gboolean
 terminal_screen_has_foreground_process (TerminalScreen *screen)
 {
-  VtePty *pty;
-  int     fd;
-  int     fgpid;
-
   if (screen == NULL || screen->pid == -1)
     return FALSE;
 
-  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
-  if (pty == NULL)
-    return FALSE;
-
-  fd = vte_pty_get_fd (pty);
-  if (fd == -1)
-    return FALSE;
+  /* apply a pending lookup, or the first one if there was no output */
+  if (screen->fg_check_id != 0 || screen->fg_pid == -1)
+    {
+      if (screen->fg_check_id != 0)
+        terminal_timer_remove (screen->fg_check_id);
+      terminal_screen_foreground_check (screen);
+    }
 
-  fgpid = tcgetpgrp (fd);
-  if (fgpid == -1 || fgpid == screen->pid)
-    return FALSE;
+  /* a job might have taken the terminal after the last sample without
+   * printing anything, ask the pty before closing would kill it */
+  if (screen->fg_pid == screen->pid)
+    terminal_screen_set_foreground (screen, terminal_screen_get_foreground_pgrp (screen));
 
-  return TRUE;
+  return screen->fg_pid != -1 && screen->fg_pid != screen->pid;
 }
 
 
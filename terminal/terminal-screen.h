@@ -23,6 +23,7 @@
 #include <gtk/gtk.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-options.h>
+#include <terminal/terminal-search.h>
 
 G_BEGIN_DECLS
 
@@ -69,9 +70,18 @@ void            terminal_screen_force_resize_window       (TerminalScreen *scree
                                                            glong           force_columns,
                                                            glong           force_rows);
 
+void            terminal_screen_apply_window_size         (TerminalScreen *screen,
+                                                           GtkWindow      *window,
+                                                           glong           columns,
+                                                           glong           rows);
+
+void            terminal_screen_apply_window_geometry_hints (TerminalScreen *screen,
+                                                             GtkWindow      *window);
+
 gchar          *terminal_screen_get_title                 (TerminalScreen *screen);
 
 const gchar    *terminal_screen_get_working_directory     (TerminalScreen *screen);
+const gchar    *terminal_screen_peek_working_directory    (TerminalScreen *screen);
 void            terminal_screen_set_working_directory     (TerminalScreen *screen,
                                                            const gchar    *directory);
 
@@ -105,6 +115,22 @@ void            terminal_screen_search_set_gregex         (TerminalScreen *scree
                                                            VteRegex       *regex,
                                                            gboolean        wrap_around);
 gboolean        terminal_screen_search_has_gregex         (TerminalScreen *screen);
+void            terminal_screen_search_incremental        (TerminalScreen *screen,
+                                                           VteRegex       *regex,
+                                                           GRegex         *scan_regex,
+                                                           gboolean        wrap_around,
+                                                           gboolean        jump);
+void            terminal_screen_search_clear_matches      (TerminalScreen *screen);
+gboolean        terminal_screen_search_get_matches        (TerminalScreen *screen,
+                                                           guint          *current,
+                                                           guint          *total);
+TerminalSearchScan *
+                terminal_screen_search_scan               (TerminalScreen *screen,
+                                                           GRegex         *regex,
+                                                           TerminalSearchFunc func,
+                                                           gpointer        user_data);
+void            terminal_screen_scroll_to_row             (TerminalScreen *screen,
+                                                           glong           row);
 
 void            terminal_screen_search_find_next          (TerminalScreen *screen);
 void            terminal_screen_search_find_previous      (TerminalScreen *screen);
@@ -121,6 +147,9 @@ gboolean        terminal_screen_get_scroll_on_output      (TerminalScreen *scree
 void            terminal_screen_set_scroll_on_output      (TerminalScreen *screen,
                                                            gboolean        enabled);
 
+void            terminal_screen_set_hidden                (TerminalScreen *screen,
+                                                           gboolean        hidden);
+
 void            terminal_screen_save_contents             (TerminalScreen *screen,
                                                            GOutputStream  *stream,
                                                            GError         *error);
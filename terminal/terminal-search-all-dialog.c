@@ -0,0 +1,549 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <libxfce4ui/libxfce4ui.h>
+
+#include <terminal/terminal-search-all-dialog.h>
+#include <terminal/terminal-search.h>
+#include <terminal/terminal-screen.h>
+#include <terminal/terminal-window.h>
+
+/* rows listed per tab, the matches after it are only counted */
+#define MAX_PREVIEWS 1000
+
+
+
+enum
+{
+  TERMINAL_RESPONSE_SEARCH_ALL
+};
+
+enum
+{
+  COLUMN_LOCATION,
+  COLUMN_PREVIEW,
+  COLUMN_TAB,
+  COLUMN_ROW,
+  N_COLUMNS
+};
+
+typedef struct _TerminalSearchAllTab TerminalSearchAllTab;
+
+static void terminal_search_all_dialog_finalize      (GObject                 *object);
+static void terminal_search_all_dialog_response      (GtkDialog               *dialog,
+                                                      gint                     response_id);
+static void terminal_search_all_dialog_stop          (TerminalSearchAllDialog *dialog);
+static void terminal_search_all_dialog_clear         (TerminalSearchAllDialog *dialog);
+static void terminal_search_all_dialog_start         (TerminalSearchAllDialog *dialog);
+static void terminal_search_all_dialog_update_status (TerminalSearchAllDialog *dialog);
+static void terminal_search_all_dialog_entry_changed (TerminalSearchAllDialog *dialog);
+static void terminal_search_all_dialog_row_activated (GtkTreeView             *view,
+                                                      GtkTreePath             *path,
+                                                      GtkTreeViewColumn       *column,
+                                                      TerminalSearchAllDialog *dialog);
+
+
+
+struct _TerminalSearchAllDialogClass
+{
+  GtkDialogClass parent_class;
+};
+
+struct _TerminalSearchAllDialog
+{
+  GtkDialog     parent_instance;
+
+  GtkWidget    *button_find;
+  GtkWidget    *entry;
+  GtkWidget    *match_case;
+  GtkWidget    *match_regex;
+  GtkWidget    *match_word;
+  GtkWidget    *status;
+
+  GtkTreeStore *store;
+
+  /* tabs of the last search and the number still being scanned, they
+   * are kept with the results until the next search */
+  GSList       *tabs;
+  guint         n_running;
+  guint         n_matches;
+};
+
+struct _TerminalSearchAllTab
+{
+  TerminalSearchAllDialog *dialog;
+  TerminalSearchScan      *scan;
+
+  /* not referenced, %NULL once the tab is closed */
+  TerminalScreen          *screen;
+
+  /* the row of the tab is added with its first match */
+  GtkTreeIter              iter;
+  guint                    has_iter : 1;
+  guint                    n_matches;
+};
+
+
+
+G_DEFINE_TYPE (TerminalSearchAllDialog, terminal_search_all_dialog, GTK_TYPE_DIALOG)
+
+
+
+static void
+terminal_search_all_dialog_class_init (TerminalSearchAllDialogClass *klass)
+{
+  GObjectClass   *gobject_class;
+  GtkDialogClass *gtkdialog_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_search_all_dialog_finalize;
+
+  gtkdialog_class = GTK_DIALOG_CLASS (klass);
+  gtkdialog_class->response = terminal_search_all_dialog_response;
+}
+
+
+
+static void
+terminal_search_all_dialog_init (TerminalSearchAllDialog *dialog)
+{
+  GtkWidget         *close_button;
+  GtkWidget         *hbox;
+  GtkWidget         *vbox;
+  GtkWidget         *label;
+  GtkWidget         *scroll;
+  GtkWidget         *view;
+  GtkCellRenderer   *renderer;
+  GtkTreeViewColumn *column;
+
+  gtk_window_set_title (GTK_WINDOW (dialog), _("Find in All Tabs"));
+  gtk_window_set_default_size (GTK_WINDOW (dialog), 600, 400);
+
+  close_button = xfce_gtk_button_new_mixed ("window-close", _("_Close"));
+  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), close_button, GTK_RESPONSE_CLOSE);
+
+  dialog->button_find = xfce_gtk_button_new_mixed ("edit-find", _("_Find"));
+  gtk_dialog_add_action_widget (GTK_DIALOG (dialog), dialog->button_find, TERMINAL_RESPONSE_SEARCH_ALL);
+  gtk_widget_set_can_default (dialog->button_find, TRUE);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), TERMINAL_RESPONSE_SEARCH_ALL);
+
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), vbox, TRUE, TRUE, 0);
+  gtk_container_set_border_width (GTK_CONTAINER (vbox), 6);
+
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, TRUE, 0);
+
+  label = gtk_label_new_with_mnemonic (_("_Search for:"));
+  gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+
+  dialog->entry = gtk_entry_new ();
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->entry, TRUE, TRUE, 0);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), dialog->entry);
+  gtk_entry_set_activates_default (GTK_ENTRY (dialog->entry), TRUE);
+  g_signal_connect_swapped (G_OBJECT (dialog->entry), "changed",
+      G_CALLBACK (terminal_search_all_dialog_entry_changed), dialog);
+
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, TRUE, 0);
+
+  dialog->match_case = gtk_check_button_new_with_mnemonic (_("C_ase sensitive"));
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->match_case, FALSE, FALSE, 0);
+
+  dialog->match_regex = gtk_check_button_new_with_mnemonic (_("Match as _regular expression"));
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->match_regex, FALSE, FALSE, 0);
+
+  dialog->match_word = gtk_check_button_new_with_mnemonic (_("Match _entire word only"));
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->match_word, FALSE, FALSE, 0);
+
+  dialog->store = gtk_tree_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+                                      G_TYPE_POINTER, G_TYPE_LONG);
+
+  scroll = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scroll), GTK_SHADOW_IN);
+  gtk_box_pack_start (GTK_BOX (vbox), scroll, TRUE, TRUE, 0);
+
+  view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (dialog->store));
+  gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (view), FALSE);
+  gtk_tree_view_set_enable_search (GTK_TREE_VIEW (view), FALSE);
+  gtk_container_add (GTK_CONTAINER (scroll), view);
+  g_signal_connect (G_OBJECT (view), "row-activated",
+      G_CALLBACK (terminal_search_all_dialog_row_activated), dialog);
+
+  renderer = gtk_cell_renderer_text_new ();
+  column = gtk_tree_view_column_new_with_attributes (NULL, renderer, "text", COLUMN_LOCATION, NULL);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (view), column);
+
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer), "ellipsize", PANGO_ELLIPSIZE_END, "family", "Monospace", NULL);
+  column = gtk_tree_view_column_new_with_attributes (NULL, renderer, "text", COLUMN_PREVIEW, NULL);
+  gtk_tree_view_column_set_expand (column, TRUE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (view), column);
+
+  dialog->status = gtk_label_new (NULL);
+  gtk_label_set_xalign (GTK_LABEL (dialog->status), 0.0);
+  gtk_style_context_add_class (gtk_widget_get_style_context (dialog->status), GTK_STYLE_CLASS_DIM_LABEL);
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->status, FALSE, FALSE, 0);
+
+  terminal_search_all_dialog_entry_changed (dialog);
+}
+
+
+
+static void
+terminal_search_all_dialog_finalize (GObject *object)
+{
+  TerminalSearchAllDialog *dialog = TERMINAL_SEARCH_ALL_DIALOG (object);
+
+  terminal_search_all_dialog_clear (dialog);
+  g_object_unref (G_OBJECT (dialog->store));
+
+  (*G_OBJECT_CLASS (terminal_search_all_dialog_parent_class)->finalize) (object);
+}
+
+
+
+static void
+terminal_search_all_dialog_response (GtkDialog *dialog,
+                                     gint       response_id)
+{
+  TerminalSearchAllDialog *search_dialog = TERMINAL_SEARCH_ALL_DIALOG (dialog);
+
+  if (response_id == TERMINAL_RESPONSE_SEARCH_ALL)
+    {
+      terminal_search_all_dialog_start (search_dialog);
+    }
+  else
+    {
+      /* the results stay until the next search */
+      terminal_search_all_dialog_stop (search_dialog);
+      terminal_search_all_dialog_update_status (search_dialog);
+      gtk_widget_hide (GTK_WIDGET (dialog));
+    }
+}
+
+
+
+static void
+terminal_search_all_dialog_stop (TerminalSearchAllDialog *dialog)
+{
+  TerminalSearchAllTab *tab;
+  GSList               *lp;
+
+  for (lp = dialog->tabs; lp != NULL; lp = lp->next)
+    {
+      tab = lp->data;
+      if (tab->scan != NULL)
+        {
+          terminal_search_scan_cancel (tab->scan);
+          tab->scan = NULL;
+        }
+    }
+
+  dialog->n_running = 0;
+}
+
+
+
+static void
+terminal_search_all_dialog_clear (TerminalSearchAllDialog *dialog)
+{
+  TerminalSearchAllTab *tab;
+  GSList               *lp;
+
+  terminal_search_all_dialog_stop (dialog);
+
+  /* the rows point to the tabs */
+  gtk_tree_store_clear (dialog->store);
+  dialog->n_matches = 0;
+
+  for (lp = dialog->tabs; lp != NULL; lp = lp->next)
+    {
+      tab = lp->data;
+      if (tab->screen != NULL)
+        g_signal_handlers_disconnect_matched (G_OBJECT (tab->screen), G_SIGNAL_MATCH_DATA,
+                                              0, 0, NULL, NULL, tab);
+      g_slice_free (TerminalSearchAllTab, tab);
+    }
+
+  g_slist_free (dialog->tabs);
+  dialog->tabs = NULL;
+}
+
+
+
+static void
+terminal_search_all_dialog_screen_destroyed (TerminalScreen       *screen,
+                                             TerminalSearchAllTab *tab)
+{
+  TerminalSearchAllDialog *dialog = tab->dialog;
+
+  terminal_return_if_fail (tab->screen == screen);
+
+  if (tab->scan != NULL)
+    {
+      terminal_search_scan_cancel (tab->scan);
+      tab->scan = NULL;
+      dialog->n_running--;
+    }
+
+  /* the results of a closed tab are of no use */
+  if (tab->has_iter)
+    {
+      gtk_tree_store_remove (dialog->store, &tab->iter);
+      tab->has_iter = FALSE;
+    }
+  dialog->n_matches -= tab->n_matches;
+  tab->n_matches = 0;
+  tab->screen = NULL;
+
+  terminal_search_all_dialog_update_status (dialog);
+}
+
+
+
+static void
+terminal_search_all_dialog_scanned (const TerminalSearchMatch *matches,
+                                    guint                      n_matches,
+                                    gboolean                   finished,
+                                    gpointer                   user_data)
+{
+  TerminalSearchAllTab    *tab = user_data;
+  TerminalSearchAllDialog *dialog = tab->dialog;
+  GtkTreeIter              iter;
+  gchar                   *title;
+  gchar                   *location;
+  guint                    n;
+
+  if (finished)
+    {
+      /* the scan releases itself after this */
+      tab->scan = NULL;
+      dialog->n_running--;
+      terminal_search_all_dialog_update_status (dialog);
+      return;
+    }
+
+  if (!tab->has_iter)
+    {
+      gtk_tree_store_insert_with_values (dialog->store, &tab->iter, NULL, -1,
+                                         COLUMN_TAB, tab,
+                                         COLUMN_ROW, (glong) -1,
+                                         -1);
+      tab->has_iter = TRUE;
+    }
+
+  /* list the rows with a preview, up to a limit per tab */
+  for (n = 0; n < n_matches && tab->n_matches + n < MAX_PREVIEWS; n++)
+    {
+      location = g_strdup_printf ("%ld", matches[n].row + 1);
+      gtk_tree_store_insert_with_values (dialog->store, &iter, &tab->iter, -1,
+                                         COLUMN_LOCATION, location,
+                                         COLUMN_PREVIEW, matches[n].line,
+                                         COLUMN_TAB, tab,
+                                         COLUMN_ROW, matches[n].row,
+                                         -1);
+      g_free (location);
+    }
+
+  tab->n_matches += n_matches;
+  dialog->n_matches += n_matches;
+
+  title = terminal_screen_get_title (tab->screen);
+  location = g_strdup_printf ("%s (%u)", title, tab->n_matches);
+  gtk_tree_store_set (dialog->store, &tab->iter, COLUMN_LOCATION, location, -1);
+  g_free (location);
+  g_free (title);
+
+  terminal_search_all_dialog_update_status (dialog);
+}
+
+
+
+static void
+terminal_search_all_dialog_start (TerminalSearchAllDialog *dialog)
+{
+  TerminalSearchAllTab *tab;
+  GtkWidget            *notebook;
+  GRegex               *regex;
+  GError               *error = NULL;
+  GList                *windows, *li;
+  gint                  n, n_pages;
+
+  terminal_search_all_dialog_clear (dialog);
+
+  if (!IS_STRING (gtk_entry_get_text (GTK_ENTRY (dialog->entry))))
+    return;
+
+  regex = terminal_search_get_scan_regex (gtk_entry_get_text (GTK_ENTRY (dialog->entry)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)),
+      &error);
+
+  if (G_UNLIKELY (regex == NULL))
+    {
+      xfce_dialog_show_error (GTK_WINDOW (dialog), error,
+                              _("Failed to create the regular expression"));
+      g_error_free (error);
+      return;
+    }
+
+  /* one scan per tab, their chunks are matched in parallel */
+  windows = gtk_window_list_toplevels ();
+  for (li = windows; li != NULL; li = li->next)
+    {
+      if (!TERMINAL_IS_WINDOW (li->data))
+        continue;
+
+      notebook = terminal_window_get_notebook (TERMINAL_WINDOW (li->data));
+      n_pages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (notebook));
+      for (n = 0; n < n_pages; n++)
+        {
+          tab = g_slice_new0 (TerminalSearchAllTab);
+          tab->dialog = dialog;
+          tab->screen = TERMINAL_SCREEN (gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebook), n));
+          tab->scan = terminal_screen_search_scan (tab->screen, regex,
+                                                   terminal_search_all_dialog_scanned, tab);
+          g_signal_connect (G_OBJECT (tab->screen), "destroy",
+              G_CALLBACK (terminal_search_all_dialog_screen_destroyed), tab);
+          dialog->tabs = g_slist_prepend (dialog->tabs, tab);
+          dialog->n_running++;
+        }
+    }
+  g_list_free (windows);
+
+  g_regex_unref (regex);
+
+  terminal_search_all_dialog_update_status (dialog);
+}
+
+
+
+static void
+terminal_search_all_dialog_update_status (TerminalSearchAllDialog *dialog)
+{
+  GSList *lp;
+  guint   n_tabs = 0;
+  gchar  *matches;
+  gchar  *text;
+
+  if (dialog->n_running > 0)
+    {
+      text = g_strdup_printf (ngettext ("Searching %u tab...", "Searching %u tabs...", dialog->n_running),
+                              dialog->n_running);
+    }
+  else if (dialog->tabs == NULL)
+    {
+      text = NULL;
+    }
+  else if (dialog->n_matches == 0)
+    {
+      text = g_strdup (_("No matches"));
+    }
+  else
+    {
+      for (lp = dialog->tabs; lp != NULL; lp = lp->next)
+        if (((TerminalSearchAllTab *) lp->data)->n_matches > 0)
+          n_tabs++;
+
+      matches = g_strdup_printf (ngettext ("%u match", "%u matches", dialog->n_matches), dialog->n_matches);
+      /* I18N: the number of matches and of the tabs they are in, e.g. "12 matches in 3 tabs" */
+      text = g_strdup_printf (ngettext ("%s in %u tab", "%s in %u tabs", n_tabs), matches, n_tabs);
+      g_free (matches);
+    }
+
+  gtk_label_set_text (GTK_LABEL (dialog->status), text);
+  g_free (text);
+}
+
+
+
+static void
+terminal_search_all_dialog_entry_changed (TerminalSearchAllDialog *dialog)
+{
+  gtk_widget_set_sensitive (dialog->button_find,
+                            IS_STRING (gtk_entry_get_text (GTK_ENTRY (dialog->entry))));
+}
+
+
+
+static void
+terminal_search_all_dialog_row_activated (GtkTreeView             *view,
+                                          GtkTreePath             *path,
+                                          GtkTreeViewColumn       *column,
+                                          TerminalSearchAllDialog *dialog)
+{
+  TerminalSearchAllTab *tab;
+  TerminalScreen       *screen;
+  GtkTreeIter           iter;
+  GtkWidget            *toplevel;
+  GtkWidget            *notebook;
+  glong                 row;
+
+  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (dialog->store), &iter, path))
+    return;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (dialog->store), &iter,
+                      COLUMN_TAB, &tab,
+                      COLUMN_ROW, &row,
+                      -1);
+
+  /* the rows of a closed tab are removed with it */
+  screen = tab->screen;
+  if (G_UNLIKELY (screen == NULL))
+    return;
+
+  /* the tab might have been moved to a window */
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+  if (TERMINAL_IS_WINDOW (toplevel))
+    {
+      notebook = terminal_window_get_notebook (TERMINAL_WINDOW (toplevel));
+      gtk_notebook_set_current_page (GTK_NOTEBOOK (notebook),
+                                     gtk_notebook_page_num (GTK_NOTEBOOK (notebook), GTK_WIDGET (screen)));
+      if (row >= 0)
+        terminal_screen_scroll_to_row (screen, row);
+      gtk_window_present (GTK_WINDOW (toplevel));
+    }
+}
+
+
+
+GtkWidget *
+terminal_search_all_dialog_new (GtkWindow *parent)
+{
+  return g_object_new (TERMINAL_TYPE_SEARCH_ALL_DIALOG,
+                       "transient-for", parent,
+                       "destroy-with-parent", TRUE,
+                       NULL);
+}
+
+
+
+void
+terminal_search_all_dialog_present (TerminalSearchAllDialog *dialog)
+{
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_ALL_DIALOG (dialog));
+
+  gtk_widget_show_all (GTK_WIDGET (dialog));
+  gtk_window_present (GTK_WINDOW (dialog));
+  gtk_widget_grab_focus (dialog->entry);
+}
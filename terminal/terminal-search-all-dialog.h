@@ -0,0 +1,43 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SEARCH_ALL_DIALOG_H
+#define TERMINAL_SEARCH_ALL_DIALOG_H
+
+#include <terminal-private.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_SEARCH_ALL_DIALOG            (terminal_search_all_dialog_get_type ())
+#define TERMINAL_SEARCH_ALL_DIALOG(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_SEARCH_ALL_DIALOG, TerminalSearchAllDialog))
+#define TERMINAL_SEARCH_ALL_DIALOG_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_SEARCH_ALL_DIALOG, TerminalSearchAllDialogClass))
+#define TERMINAL_IS_SEARCH_ALL_DIALOG(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_SEARCH_ALL_DIALOG))
+#define TERMINAL_IS_SEARCH_ALL_DIALOG_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_SEARCH_ALL_DIALOG))
+#define TERMINAL_SEARCH_ALL_DIALOG_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_SEARCH_ALL_DIALOG, TerminalSearchAllDialogClass))
+
+typedef struct _TerminalSearchAllDialog      TerminalSearchAllDialog;
+typedef struct _TerminalSearchAllDialogClass TerminalSearchAllDialogClass;
+
+GType      terminal_search_all_dialog_get_type (void) G_GNUC_CONST;
+
+GtkWidget *terminal_search_all_dialog_new      (GtkWindow               *parent);
+
+void       terminal_search_all_dialog_present  (TerminalSearchAllDialog *dialog);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SEARCH_ALL_DIALOG_H */
@@ -30,12 +30,15 @@
 
 #include <terminal/terminal-search-dialog.h>
 #include <terminal/terminal-preferences.h>
+#include <terminal/terminal-search.h>
+#include <terminal/terminal-timer.h>
 
 
 
 static void terminal_search_dialog_finalize           (GObject              *object);
 static void terminal_search_dialog_opacity_changed    (TerminalSearchDialog *dialog);
 static void terminal_search_dialog_clear_gregex       (TerminalSearchDialog *dialog);
+static void terminal_search_dialog_changed            (TerminalSearchDialog *dialog);
 static void terminal_search_dialog_entry_icon_release (GtkWidget            *entry,
                                                        GtkEntryIconPosition  icon_pos);
 static void terminal_search_dialog_entry_changed      (GtkWidget            *entry,
@@ -52,11 +55,16 @@ struct _TerminalSearchDialog
   GtkDialog      parent_instance;
 
   VteRegex        *last_gregex;
+  GRegex        *last_scan_regex;
+
+  /* delays the incremental search while typing */
+  guint          changed_timer_id;
 
   GtkWidget     *button_prev;
   GtkWidget     *button_next;
 
   GtkWidget     *entry;
+  GtkWidget     *matches;
 
   GtkWidget     *match_case;
   GtkWidget     *match_regex;
@@ -139,26 +147,31 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   g_signal_connect (G_OBJECT (dialog->entry), "changed",
       G_CALLBACK (terminal_search_dialog_entry_changed), dialog);
 
+  dialog->matches = gtk_label_new (NULL);
+  gtk_label_set_xalign (GTK_LABEL (dialog->matches), 1.0);
+  gtk_style_context_add_class (gtk_widget_get_style_context (dialog->matches), GTK_STYLE_CLASS_DIM_LABEL);
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->matches, FALSE, FALSE, 0);
+
   dialog->match_case = gtk_check_button_new_with_mnemonic (_("C_ase sensitive"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_case, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_case), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_changed), dialog);
 
   dialog->match_regex = gtk_check_button_new_with_mnemonic (_("Match as _regular expression"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_regex, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_regex), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_changed), dialog);
 
   dialog->match_word = gtk_check_button_new_with_mnemonic (_("Match _entire word only"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_word, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_word), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_changed), dialog);
 
   dialog->wrap_around = gtk_check_button_new_with_mnemonic (_("_Wrap around"));
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->wrap_around), TRUE);
   gtk_box_pack_start (GTK_BOX (vbox), dialog->wrap_around, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->wrap_around), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_changed), dialog);
 
   opacity_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
   gtk_widget_set_margin_start (opacity_box, 6);
@@ -195,7 +208,12 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
 static void
 terminal_search_dialog_finalize (GObject *object)
 {
-  terminal_search_dialog_clear_gregex (TERMINAL_SEARCH_DIALOG (object));
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (object);
+
+  if (dialog->changed_timer_id != 0)
+    terminal_timer_remove (dialog->changed_timer_id);
+
+  terminal_search_dialog_clear_gregex (dialog);
 
   (*G_OBJECT_CLASS (terminal_search_dialog_parent_class)->finalize) (object);
 }
@@ -222,6 +240,42 @@ terminal_search_dialog_clear_gregex (TerminalSearchDialog *dialog)
       vte_regex_unref (dialog->last_gregex);
       dialog->last_gregex = NULL;
     }
+
+  if (dialog->last_scan_regex != NULL)
+    {
+      g_regex_unref (dialog->last_scan_regex);
+      dialog->last_scan_regex = NULL;
+    }
+}
+
+
+
+static gboolean
+terminal_search_dialog_changed_timeout (gpointer user_data)
+{
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (user_data);
+
+  dialog->changed_timer_id = 0;
+
+  if (gtk_widget_get_visible (GTK_WIDGET (dialog)))
+    gtk_dialog_response (GTK_DIALOG (dialog), TERMINAL_RESPONSE_SEARCH_CHANGED);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_search_dialog_changed (TerminalSearchDialog *dialog)
+{
+  terminal_search_dialog_clear_gregex (dialog);
+
+  /* restart the delay, so only a pause in typing starts a search */
+  if (dialog->changed_timer_id != 0)
+    terminal_timer_remove (dialog->changed_timer_id);
+  dialog->changed_timer_id = terminal_timer_add (TERMINAL_WAKEUP_SEARCH, 200,
+                                                 terminal_search_dialog_changed_timeout,
+                                                 dialog, NULL);
 }
 
 
@@ -246,7 +300,7 @@ terminal_search_dialog_entry_changed (GtkWidget            *entry,
   text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
   has_text = IS_STRING (text);
 
-  terminal_search_dialog_clear_gregex (dialog);
+  terminal_search_dialog_changed (dialog);
 
   gtk_widget_set_sensitive (dialog->button_prev, has_text);
   gtk_widget_set_sensitive (dialog->button_next, has_text);
@@ -281,10 +335,7 @@ VteRegex *
 terminal_search_dialog_get_regex (TerminalSearchDialog  *dialog,
                                   GError               **error)
 {
-  const gchar        *pattern;
-  guint32             flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
-  gchar              *pattern_escaped = NULL;
-  gchar              *word_regex = NULL;
+  const gchar        *text;
   VteRegex           *regex;
 
   terminal_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
@@ -295,44 +346,101 @@ terminal_search_dialog_get_regex (TerminalSearchDialog  *dialog,
     return vte_regex_ref (dialog->last_gregex);
 
   /* unset if no pattern is typed */
-  pattern = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
-  if (!IS_STRING (pattern))
+  text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
+  if (!IS_STRING (text))
     return NULL;
 
-  if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)))
-    flags |= PCRE2_CASELESS;
+  regex = terminal_search_get_regex (text,
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)),
+      error);
 
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
-    {
-/* MULTILINE flag is always used for pcre2 */
-      flags |= G_REGEX_MULTILINE;
-    }
-  else
-    {
-      pattern_escaped = g_regex_escape_string (pattern, -1);
-      pattern = pattern_escaped;
-    }
+  /* keep around */
+  if (regex != NULL)
+    dialog->last_gregex = vte_regex_ref (regex);
 
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)))
-    {
-      word_regex = g_strdup_printf ("\\b%s\\b", pattern);
-      pattern = word_regex;
-    }
+  return regex;
+}
 
-  regex = vte_regex_new_for_search (pattern, -1, flags, error);
 
-  g_free (pattern_escaped);
-  g_free (word_regex);
 
-  /* keep around */
+/**
+ * terminal_search_dialog_get_scan_regex:
+ * @dialog : A #TerminalSearchDialog.
+ * @error  : Return location for errors or %NULL.
+ *
+ * The same expression as terminal_search_dialog_get_regex(), but as
+ * a #GRegex that can be matched outside of the terminal, see
+ * terminal_search_scan_start().
+ *
+ * Return value : The #GRegex or %NULL if no pattern is typed or on
+ *                error. Release with g_regex_unref().
+ **/
+GRegex *
+terminal_search_dialog_get_scan_regex (TerminalSearchDialog  *dialog,
+                                       GError               **error)
+{
+  const gchar        *text;
+  GRegex             *regex;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (dialog->last_scan_regex != NULL)
+    return g_regex_ref (dialog->last_scan_regex);
+
+  text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
+  if (!IS_STRING (text))
+    return NULL;
+
+  regex = terminal_search_get_scan_regex (text,
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)),
+      gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)),
+      error);
+
   if (regex != NULL)
-    dialog->last_gregex = vte_regex_ref (regex);
+    dialog->last_scan_regex = g_regex_ref (regex);
 
   return regex;
 }
 
 
 
+/**
+ * terminal_search_dialog_set_matches:
+ * @dialog  : A #TerminalSearchDialog.
+ * @indexed : Whether the matches are indexed, hides the count if not.
+ * @current : Position of the current match starting at 1 or 0.
+ * @total   : Number of matches.
+ **/
+void
+terminal_search_dialog_set_matches (TerminalSearchDialog *dialog,
+                                    gboolean              indexed,
+                                    guint                 current,
+                                    guint                 total)
+{
+  gchar *text;
+
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  if (!indexed || !IS_STRING (gtk_entry_get_text (GTK_ENTRY (dialog->entry))))
+    text = NULL;
+  else if (total == 0)
+    text = g_strdup (_("No matches"));
+  else if (current > 0)
+    /* I18N: position of the current search match, e.g. "3 of 1,274" */
+    text = g_strdup_printf (_("%'u of %'u"), current, total);
+  else
+    text = g_strdup_printf (ngettext ("%'u match", "%'u matches", total), total);
+
+  gtk_label_set_text (GTK_LABEL (dialog->matches), text);
+  g_free (text);
+}
+
+
+
 void
 terminal_search_dialog_present (TerminalSearchDialog *dialog)
 {
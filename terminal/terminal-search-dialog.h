@@ -35,7 +35,8 @@ typedef struct _TerminalSearchDialogClass TerminalSearchDialogClass;
 enum
 {
   TERMINAL_RESPONSE_SEARCH_NEXT,
-  TERMINAL_RESPONSE_SEARCH_PREV
+  TERMINAL_RESPONSE_SEARCH_PREV,
+  TERMINAL_RESPONSE_SEARCH_CHANGED
 };
 
 GType      terminal_search_dialog_get_type        (void) G_GNUC_CONST;
@@ -47,6 +48,14 @@ gboolean   terminal_search_dialog_get_wrap_around (TerminalSearchDialog  *dialog
 VteRegex    *terminal_search_dialog_get_regex       (TerminalSearchDialog  *dialog,
                                                    GError               **error);
 
+GRegex    *terminal_search_dialog_get_scan_regex  (TerminalSearchDialog  *dialog,
+                                                   GError               **error);
+
+void       terminal_search_dialog_set_matches     (TerminalSearchDialog  *dialog,
+                                                   gboolean               indexed,
+                                                   guint                  current,
+                                                   guint                  total);
+
 void       terminal_search_dialog_present         (TerminalSearchDialog  *dialog);
 
 G_END_DECLS
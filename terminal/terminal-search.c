@@ -0,0 +1,808 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-search.h>
+#include <terminal/terminal-private.h>
+
+/* rows copied out of the terminal per main loop iteration */
+#define SCAN_CHUNK_ROWS 256
+
+/* number of recent search expressions kept compiled */
+#define REGEX_CACHE_SIZE 16
+
+
+
+typedef struct _TerminalSearchJob   TerminalSearchJob;
+typedef struct _TerminalSearchRegex TerminalSearchRegex;
+
+static void     terminal_search_scan_unref    (TerminalSearchScan *scan);
+static void     terminal_search_scan_release  (TerminalSearchScan *scan);
+static void     terminal_search_job_free      (TerminalSearchJob  *job);
+static gboolean terminal_search_row_wrapped   (VteTerminal        *terminal,
+                                               glong               row,
+                                               glong               columns);
+static void     terminal_search_append_cells  (GArray             *cells,
+                                               const gchar        *text,
+                                               gsize               len,
+                                               GArray             *attributes,
+                                               gboolean            line_end);
+static gboolean terminal_search_scan_snapshot (gpointer            user_data);
+static void     terminal_search_job_run       (gpointer            data,
+                                               gpointer            user_data);
+static gboolean terminal_search_job_finished  (gpointer            user_data);
+static gchar   *terminal_search_build_pattern (const gchar        *text,
+                                               gboolean            match_regex,
+                                               gboolean            match_word);
+
+
+
+struct _TerminalSearchScan
+{
+  gint                ref_count;
+  gint                cancelled;
+
+  VteTerminal        *terminal;
+  GRegex             *regex;
+
+  TerminalSearchFunc  func;
+  gpointer            user_data;
+
+  /* rows left to scan are [lower, up) and [down, upper) */
+  glong               lower;
+  glong               upper;
+  glong               up;
+  glong               down;
+  guint               scan_up : 1;
+  guint               previews : 1;
+
+  guint               idle_id;
+};
+
+struct _TerminalSearchJob
+{
+  TerminalSearchScan *scan;
+
+  /* rows joined with '\n' and the byte offset of each row */
+  GString            *text;
+  GArray             *offsets;
+  glong               first_row;
+
+  /* terminal cell of each byte of the text in its row, tabs and wide
+   * characters take more than one cell */
+  GArray             *cells;
+  glong               columns;
+
+  GArray             *matches;
+};
+
+struct _TerminalSearchRegex
+{
+  gchar              *key;
+
+  /* compiled on first use */
+  VteRegex           *regex;
+  GRegex             *scan_regex;
+};
+
+
+
+static GThreadPool *search_pool = NULL;
+
+/* most recently used expressions first, shared by all windows */
+static GQueue       regex_cache_lru = G_QUEUE_INIT;
+static GHashTable  *regex_cache = NULL;
+
+
+
+static void
+terminal_search_scan_unref (TerminalSearchScan *scan)
+{
+  if (g_atomic_int_dec_and_test (&scan->ref_count))
+    {
+      terminal_assert (scan->terminal == NULL);
+      terminal_assert (scan->idle_id == 0);
+
+      g_regex_unref (scan->regex);
+      g_slice_free (TerminalSearchScan, scan);
+    }
+}
+
+
+
+static void
+terminal_search_scan_release (TerminalSearchScan *scan)
+{
+  g_atomic_int_set (&scan->cancelled, TRUE);
+
+  if (scan->idle_id != 0)
+    {
+      g_source_remove (scan->idle_id);
+      scan->idle_id = 0;
+    }
+
+  /* a job still in flight must not keep the terminal alive */
+  g_clear_object (&scan->terminal);
+
+  terminal_search_scan_unref (scan);
+}
+
+
+
+static void
+terminal_search_job_free (TerminalSearchJob *job)
+{
+  terminal_search_scan_unref (job->scan);
+  g_string_free (job->text, TRUE);
+  g_array_free (job->offsets, TRUE);
+  g_array_free (job->cells, TRUE);
+  g_array_free (job->matches, TRUE);
+  g_slice_free (TerminalSearchJob, job);
+}
+
+
+
+static gboolean
+terminal_search_row_wrapped (VteTerminal *terminal,
+                             glong        row,
+                             glong        columns)
+{
+  gchar    *text;
+  gboolean  wrapped;
+
+  /* vte only puts a line break between two rows if the first one
+   * does not continue on the second */
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  text = vte_terminal_get_text_range (terminal, row, columns - 1, row + 1, 0,
+                                      NULL, NULL, NULL);
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  wrapped = text != NULL && strchr (text, '\n') == NULL;
+  g_free (text);
+
+  return wrapped;
+}
+
+
+
+static gint
+terminal_search_cell_width (gunichar c,
+                            gint     column)
+{
+  /* the default tab stops of vte */
+  if (c == '\t')
+    return 8 - column % 8;
+
+  if (g_unichar_iszerowidth (c))
+    return 0;
+
+  return g_unichar_iswide (c) ? 2 : 1;
+}
+
+
+
+static void
+terminal_search_append_cells (GArray      *cells,
+                              const gchar *text,
+                              gsize        len,
+                              GArray      *attributes,
+                              gboolean     line_end)
+{
+  const gchar *p, *next;
+  gint         column = 0;
+  gint         start;
+  gsize        i;
+
+  /* vte knows the cell of each byte, otherwise it is estimated the
+   * same way for characters vte placed itself */
+  for (p = text; p < text + len; p = next)
+    {
+      next = g_utf8_next_char (p);
+      start = attributes->len >= len
+              ? g_array_index (attributes, VteCharAttributes, p - text).column
+              : column;
+      for (i = p - text; i < (gsize) (next - text); i++)
+        g_array_append_val (cells, start);
+      column = start + terminal_search_cell_width (g_utf8_get_char (p), start);
+    }
+
+  /* the line break ends the last character */
+  if (line_end)
+    g_array_append_val (cells, column);
+}
+
+
+
+static glong
+terminal_search_line_start (VteTerminal *terminal,
+                            glong        row,
+                            glong        lower,
+                            glong        upper)
+{
+  glong columns = vte_terminal_get_column_count (terminal);
+
+  if (row >= upper)
+    return row;
+
+  while (row > lower && terminal_search_row_wrapped (terminal, row - 1, columns))
+    row--;
+
+  return row;
+}
+
+
+
+static gboolean
+terminal_search_scan_snapshot (gpointer user_data)
+{
+  TerminalSearchScan *scan = user_data;
+  TerminalSearchJob  *job;
+  glong               first, last;
+  glong               row;
+  glong               columns;
+  gchar              *text;
+  gsize               len;
+  gsize               offset;
+  gboolean            scan_up;
+  gboolean            wrapped = FALSE;
+  GArray             *attributes;
+
+  scan->idle_id = 0;
+
+  /* alternate below and above the view, so the nearest rows come first */
+  if (scan->down >= scan->upper)
+    scan->scan_up = TRUE;
+  else if (scan->up <= scan->lower)
+    scan->scan_up = FALSE;
+
+  /* stop when the terminal is being destroyed */
+  if (gtk_widget_in_destruction (GTK_WIDGET (scan->terminal)))
+    scan->down = scan->up = scan->lower = scan->upper;
+
+  if (scan->down >= scan->upper && scan->up <= scan->lower)
+    {
+      (*scan->func) (NULL, 0, TRUE, scan->user_data);
+
+      /* drops the reference of the owner */
+      if (!g_atomic_int_get (&scan->cancelled))
+        terminal_search_scan_release (scan);
+
+      return FALSE;
+    }
+
+  columns = vte_terminal_get_column_count (scan->terminal);
+
+  scan_up = scan->scan_up;
+  if (scan_up)
+    {
+      first = MAX (scan->lower, scan->up - SCAN_CHUNK_ROWS);
+      last = scan->up;
+      scan->up = first;
+
+      /* rows continuing a line from above are scanned with that line */
+      if (first > scan->lower)
+        while (first < last && terminal_search_row_wrapped (scan->terminal, first - 1, columns))
+          first++;
+    }
+  else
+    {
+      first = scan->down;
+      last = MIN (scan->upper, scan->down + SCAN_CHUNK_ROWS);
+    }
+  scan->scan_up = !scan_up;
+
+  job = g_slice_new0 (TerminalSearchJob);
+  job->scan = scan;
+  job->text = g_string_sized_new ((last - first) * 81);
+  job->offsets = g_array_sized_new (FALSE, FALSE, sizeof (gsize), last - first);
+  job->first_row = first;
+  job->cells = g_array_sized_new (FALSE, FALSE, sizeof (gint), (last - first) * 81);
+  job->columns = columns;
+  job->matches = g_array_new (FALSE, FALSE, sizeof (TerminalSearchMatch));
+  g_atomic_int_inc (&scan->ref_count);
+
+  attributes = g_array_new (FALSE, FALSE, sizeof (VteCharAttributes));
+
+  /* the terminal is not thread safe, so copy the rows out here; soft
+   * wrapped rows are joined and the chunk ends with a complete line */
+  for (row = first; row < last || (wrapped && row < scan->upper); row++)
+    {
+      offset = job->text->len;
+      g_array_append_val (job->offsets, offset);
+
+      g_array_set_size (attributes, 0);
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      text = vte_terminal_get_text_range (scan->terminal, row, 0, row, columns - 1,
+                                          NULL, NULL, attributes);
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+      wrapped = FALSE;
+      len = 0;
+      if (G_LIKELY (text != NULL))
+        {
+          len = strlen (text);
+          if (len > 0 && text[len - 1] == '\n')
+            len--;
+          g_string_append_len (job->text, text, len);
+
+          /* only a row with text can continue on the next one */
+          if (len > 0 && row + 1 < scan->upper)
+            wrapped = terminal_search_row_wrapped (scan->terminal, row, columns);
+        }
+      terminal_search_append_cells (job->cells, text != NULL ? text : "", len, attributes, !wrapped);
+      g_free (text);
+      if (!wrapped)
+        g_string_append_c (job->text, '\n');
+    }
+
+  g_array_free (attributes, TRUE);
+
+  if (!scan_up)
+    scan->down = row;
+
+  if (G_UNLIKELY (search_pool == NULL))
+    search_pool = g_thread_pool_new (terminal_search_job_run, NULL,
+                                     g_get_num_processors (), FALSE, NULL);
+
+  g_thread_pool_push (search_pool, job, NULL);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_search_job_run (gpointer data,
+                         gpointer user_data)
+{
+  TerminalSearchJob   *job = data;
+  TerminalSearchMatch  match;
+  GMatchInfo          *info;
+  const gsize         *offsets = (const gsize *) job->offsets->data;
+  const gchar         *row_text;
+  const gchar         *line_end;
+  const gint          *cells = (const gint *) job->cells->data;
+  gint                 start, end;
+  guint                lo, hi, mid;
+  guint                end_row;
+
+  if (g_atomic_int_get (&job->scan->cancelled))
+    goto done;
+
+  g_regex_match_full (job->scan->regex, job->text->str, job->text->len,
+                      0, 0, &info, NULL);
+  while (g_match_info_matches (info))
+    {
+      /* give up early if the user typed further */
+      if (G_UNLIKELY (g_atomic_int_get (&job->scan->cancelled)))
+        break;
+
+      if (g_match_info_fetch_pos (info, 0, &start, &end) && end > start)
+        {
+          /* find the row holding the start of the match */
+          lo = 0;
+          hi = job->offsets->len;
+          while (hi - lo > 1)
+            {
+              mid = (lo + hi) / 2;
+              if (offsets[mid] <= (gsize) start)
+                lo = mid;
+              else
+                hi = mid;
+            }
+
+          /* a match only continues on soft wrapped rows */
+          line_end = memchr (job->text->str + start, '\n', end - start);
+          if (line_end != NULL)
+            end = line_end - job->text->str;
+
+          /* skip a match of only the line separator */
+          if (G_LIKELY (end > start))
+            {
+              /* the row of the end, a soft wrapped row fills all columns */
+              for (end_row = lo; end_row + 1 < job->offsets->len; end_row++)
+                if (offsets[end_row + 1] > (gsize) end)
+                  break;
+
+              row_text = job->text->str + offsets[lo];
+              match.row = job->first_row + lo;
+              match.start_col = cells[start];
+              match.end_col = (end_row - lo) * job->columns + cells[end];
+              match.line = job->scan->previews ? row_text : NULL;
+              g_array_append_val (job->matches, match);
+            }
+        }
+
+      g_match_info_next (info, NULL);
+    }
+  g_match_info_free (info);
+
+  /* terminate the rows for the previews */
+  if (job->scan->previews)
+    g_strdelimit (job->text->str, "\n", '\0');
+
+done:
+  g_idle_add (terminal_search_job_finished, job);
+}
+
+
+
+static gboolean
+terminal_search_job_finished (gpointer user_data)
+{
+  TerminalSearchJob  *job = user_data;
+  TerminalSearchScan *scan = job->scan;
+
+  if (!g_atomic_int_get (&scan->cancelled))
+    {
+      if (job->matches->len > 0)
+        (*scan->func) ((const TerminalSearchMatch *) job->matches->data,
+                       job->matches->len, FALSE, scan->user_data);
+
+      /* the callback might have cancelled the scan */
+      if (!g_atomic_int_get (&scan->cancelled))
+        scan->idle_id = g_idle_add_full (G_PRIORITY_LOW, terminal_search_scan_snapshot,
+                                         scan, NULL);
+    }
+
+  terminal_search_job_free (job);
+
+  return FALSE;
+}
+
+
+
+/**
+ * terminal_search_scan_start:
+ * @terminal   : A #VteTerminal.
+ * @regex      : The #GRegex to search for.
+ * @first_row  : The first row to scan, clamped to the scrollback.
+ * @origin_row : The row to start at, usually the top of the view.
+ * @func       : Function called with the matches of each chunk.
+ * @user_data  : Data passed to @func.
+ *
+ * Scans the scrollback of @terminal from @first_row for @regex. Rows
+ * are copied out in chunks from an idle handler, starting at
+ * @origin_row and moving outwards in both directions, and matched on
+ * a worker thread, so the main loop stays responsive on large
+ * scrollbacks. The matches of a chunk are sorted, but chunks above
+ * the view arrive in descending order.
+ *
+ * Both rows are moved back to the start of their line, so a match
+ * continuing on soft wrapped rows is found in one piece; use
+ * terminal_search_get_line_start() to know where the scan splits.
+ *
+ * After the final call of @func with finished set to %TRUE the scan
+ * is released, until then it can be stopped with
+ * terminal_search_scan_cancel().
+ *
+ * Return value : The running scan.
+ **/
+TerminalSearchScan *
+terminal_search_scan_start (VteTerminal        *terminal,
+                            GRegex             *regex,
+                            glong               first_row,
+                            glong               origin_row,
+                            TerminalSearchFunc  func,
+                            gpointer            user_data)
+{
+  TerminalSearchScan *scan;
+  GtkAdjustment      *adjustment;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), NULL);
+  terminal_return_val_if_fail (regex != NULL, NULL);
+  terminal_return_val_if_fail (func != NULL, NULL);
+
+  scan = g_slice_new0 (TerminalSearchScan);
+  scan->ref_count = 1;
+  scan->terminal = g_object_ref (terminal);
+  scan->regex = g_regex_ref (regex);
+  scan->func = func;
+  scan->user_data = user_data;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (terminal));
+  scan->upper = gtk_adjustment_get_upper (adjustment);
+  scan->lower = CLAMP (first_row, (glong) gtk_adjustment_get_lower (adjustment), scan->upper);
+  scan->lower = terminal_search_line_start (terminal, scan->lower,
+                                            gtk_adjustment_get_lower (adjustment),
+                                            scan->upper);
+  scan->down = CLAMP (origin_row, scan->lower, scan->upper);
+  scan->down = terminal_search_line_start (terminal, scan->down, scan->lower, scan->upper);
+  scan->up = scan->down;
+
+  scan->idle_id = g_idle_add_full (G_PRIORITY_LOW, terminal_search_scan_snapshot,
+                                   scan, NULL);
+
+  return scan;
+}
+
+
+
+/**
+ * terminal_search_get_line_start:
+ * @terminal : A #VteTerminal.
+ * @row      : A row in the scrollback.
+ *
+ * Return value : The first row of the line @row is part of, going
+ *                back over soft wrapped rows.
+ **/
+glong
+terminal_search_get_line_start (VteTerminal *terminal,
+                                glong        row)
+{
+  GtkAdjustment *adjustment;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), row);
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (terminal));
+
+  return terminal_search_line_start (terminal, row,
+                                     gtk_adjustment_get_lower (adjustment),
+                                     gtk_adjustment_get_upper (adjustment));
+}
+
+
+
+/**
+ * terminal_search_scan_cancel:
+ * @scan : A #TerminalSearchScan.
+ *
+ * Stops the scan, @func is not called anymore. A chunk still being
+ * matched is dropped once the worker is done with it.
+ **/
+void
+terminal_search_scan_cancel (TerminalSearchScan *scan)
+{
+  terminal_return_if_fail (scan != NULL);
+
+  terminal_search_scan_release (scan);
+}
+
+
+
+/**
+ * terminal_search_scan_set_previews:
+ * @scan     : A #TerminalSearchScan.
+ * @previews : Whether matches carry the text of their row.
+ *
+ * Must be called right after terminal_search_scan_start().
+ **/
+void
+terminal_search_scan_set_previews (TerminalSearchScan *scan,
+                                   gboolean            previews)
+{
+  terminal_return_if_fail (scan != NULL);
+  scan->previews = !!previews;
+}
+
+
+
+static gchar *
+terminal_search_build_pattern (const gchar *text,
+                               gboolean     match_regex,
+                               gboolean     match_word)
+{
+  gchar *escaped = NULL;
+  gchar *pattern;
+
+  if (!match_regex)
+    text = escaped = g_regex_escape_string (text, -1);
+
+  if (match_word)
+    pattern = g_strdup_printf ("\\b%s\\b", text);
+  else
+    pattern = g_strdup (text);
+
+  g_free (escaped);
+
+  return pattern;
+}
+
+
+
+static void
+terminal_search_regex_free (TerminalSearchRegex *entry)
+{
+  if (entry->regex != NULL)
+    vte_regex_unref (entry->regex);
+  if (entry->scan_regex != NULL)
+    g_regex_unref (entry->scan_regex);
+  g_free (entry->key);
+  g_slice_free (TerminalSearchRegex, entry);
+}
+
+
+
+/* only insert compiled expressions, so failed ones never evict a
+ * working entry */
+static TerminalSearchRegex *
+terminal_search_regex_lookup (const gchar *text,
+                              gboolean     match_case,
+                              gboolean     match_regex,
+                              gboolean     match_word,
+                              gboolean     insert)
+{
+  TerminalSearchRegex *entry;
+  GList               *link;
+  gchar               *key;
+
+  if (G_UNLIKELY (regex_cache == NULL))
+    regex_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  key = g_strdup_printf ("%d%d%d%s", !!match_case, !!match_regex, !!match_word, text);
+
+  link = g_hash_table_lookup (regex_cache, key);
+  if (link != NULL)
+    {
+      g_free (key);
+
+      /* move to the front of the queue */
+      g_queue_unlink (&regex_cache_lru, link);
+      g_queue_push_head_link (&regex_cache_lru, link);
+
+      return link->data;
+    }
+
+  if (!insert)
+    {
+      g_free (key);
+      return NULL;
+    }
+
+  /* drop the least recently used expression */
+  if (regex_cache_lru.length >= REGEX_CACHE_SIZE)
+    {
+      entry = g_queue_pop_tail (&regex_cache_lru);
+      g_hash_table_remove (regex_cache, entry->key);
+      terminal_search_regex_free (entry);
+    }
+
+  entry = g_slice_new0 (TerminalSearchRegex);
+  entry->key = key;
+  g_queue_push_head (&regex_cache_lru, entry);
+  g_hash_table_insert (regex_cache, entry->key, regex_cache_lru.head);
+
+  return entry;
+}
+
+
+
+/**
+ * terminal_search_get_regex:
+ * @text        : The text typed by the user.
+ * @match_case  : Whether the search is case sensitive.
+ * @match_regex : Whether @text is a regular expression.
+ * @match_word  : Whether only entire words match.
+ * @error       : Return location for errors or %NULL.
+ *
+ * Returns the JIT compiled #VteRegex for the search. The last
+ * REGEX_CACHE_SIZE expressions are kept for all windows, so going
+ * back to an earlier search or searching another tab does not
+ * compile it again.
+ *
+ * Return value : The #VteRegex or %NULL on error, release with
+ *                vte_regex_unref().
+ **/
+VteRegex *
+terminal_search_get_regex (const gchar  *text,
+                           gboolean      match_case,
+                           gboolean      match_regex,
+                           gboolean      match_word,
+                           GError      **error)
+{
+  TerminalSearchRegex *entry;
+  VteRegex            *regex;
+  guint32              flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
+  gchar               *pattern;
+  GError              *jit_error = NULL;
+
+  terminal_return_val_if_fail (text != NULL, NULL);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  entry = terminal_search_regex_lookup (text, match_case, match_regex, match_word, FALSE);
+  if (entry != NULL && entry->regex != NULL)
+    return vte_regex_ref (entry->regex);
+
+  if (!match_case)
+    flags |= PCRE2_CASELESS;
+
+  if (match_regex)
+    {
+/* MULTILINE flag is always used for pcre2 */
+      flags |= G_REGEX_MULTILINE;
+    }
+
+  pattern = terminal_search_build_pattern (text, match_regex, match_word);
+  regex = vte_regex_new_for_search (pattern, -1, flags, error);
+  g_free (pattern);
+
+  if (regex == NULL)
+    return NULL;
+
+  /* without jit support vte falls back to the interpreter */
+  if (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &jit_error))
+    {
+#ifdef G_ENABLE_DEBUG
+      g_debug ("Failed to JIT search expression '%s': %s", text, jit_error->message);
+#endif
+      g_error_free (jit_error);
+    }
+
+  entry = terminal_search_regex_lookup (text, match_case, match_regex, match_word, TRUE);
+  entry->regex = regex;
+
+  return vte_regex_ref (entry->regex);
+}
+
+
+
+/**
+ * terminal_search_get_scan_regex:
+ * @text        : The text typed by the user.
+ * @match_case  : Whether the search is case sensitive.
+ * @match_regex : Whether @text is a regular expression.
+ * @match_word  : Whether only entire words match.
+ * @error       : Return location for errors or %NULL.
+ *
+ * Same as terminal_search_get_regex(), but returns the expression as
+ * #GRegex for terminal_search_scan_start(), cached in the same entry.
+ *
+ * Return value : The #GRegex or %NULL on error, release with
+ *                g_regex_unref().
+ **/
+GRegex *
+terminal_search_get_scan_regex (const gchar  *text,
+                                gboolean      match_case,
+                                gboolean      match_regex,
+                                gboolean      match_word,
+                                GError      **error)
+{
+  TerminalSearchRegex *entry;
+  GRegexCompileFlags   flags = G_REGEX_OPTIMIZE | G_REGEX_MULTILINE;
+  GRegex              *regex;
+  gchar               *pattern;
+
+  terminal_return_val_if_fail (text != NULL, NULL);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  entry = terminal_search_regex_lookup (text, match_case, match_regex, match_word, FALSE);
+  if (entry != NULL && entry->scan_regex != NULL)
+    return g_regex_ref (entry->scan_regex);
+
+  if (!match_case)
+    flags |= G_REGEX_CASELESS;
+
+  /* G_REGEX_OPTIMIZE uses the jit of pcre */
+  pattern = terminal_search_build_pattern (text, match_regex, match_word);
+  regex = g_regex_new (pattern, flags, 0, error);
+  g_free (pattern);
+
+  if (regex == NULL)
+    return NULL;
+
+  entry = terminal_search_regex_lookup (text, match_case, match_regex, match_word, TRUE);
+  entry->scan_regex = regex;
+
+  return g_regex_ref (entry->scan_regex);
+}
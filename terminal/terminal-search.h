@@ -0,0 +1,75 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SEARCH_H
+#define TERMINAL_SEARCH_H
+
+#include <vte/vte.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TerminalSearchScan TerminalSearchScan;
+
+typedef struct
+{
+  glong        row;
+
+  /* in cells of the row, a match continuing on soft wrapped rows
+   * ends past the last column */
+  gint         start_col;
+  gint         end_col;
+
+  /* text of the row with previews enabled, only valid in the callback */
+  const gchar *line;
+} TerminalSearchMatch;
+
+/* called on the main thread with the matches of each scanned chunk */
+typedef void (*TerminalSearchFunc) (const TerminalSearchMatch *matches,
+                                    guint                      n_matches,
+                                    gboolean                   finished,
+                                    gpointer                   user_data);
+
+TerminalSearchScan *terminal_search_scan_start        (VteTerminal        *terminal,
+                                                       GRegex             *regex,
+                                                       glong               first_row,
+                                                       glong               origin_row,
+                                                       TerminalSearchFunc  func,
+                                                       gpointer            user_data);
+
+glong               terminal_search_get_line_start    (VteTerminal        *terminal,
+                                                       glong               row);
+
+void                terminal_search_scan_cancel       (TerminalSearchScan *scan);
+
+void                terminal_search_scan_set_previews (TerminalSearchScan *scan,
+                                                       gboolean            previews);
+
+VteRegex           *terminal_search_get_regex         (const gchar        *text,
+                                                       gboolean            match_case,
+                                                       gboolean            match_regex,
+                                                       gboolean            match_word,
+                                                       GError            **error);
+
+GRegex             *terminal_search_get_scan_regex    (const gchar        *text,
+                                                       gboolean            match_case,
+                                                       gboolean            match_regex,
+                                                       gboolean            match_word,
+                                                       GError            **error);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SEARCH_H */
@@ -0,0 +1,365 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gdk/gdk.h>
+
+#include <terminal/terminal-timer.h>
+#include <terminal/terminal-private.h>
+
+/* number of slots in the wheel, timers further away wait for more rounds */
+#define TIMER_SLOTS 64
+
+
+
+typedef struct _TerminalTimer TerminalTimer;
+
+static void     terminal_timer_schedule (void);
+static gboolean terminal_timer_dispatch (gpointer user_data);
+
+
+
+struct _TerminalTimer
+{
+  guint          id;
+  TerminalWakeup source;
+
+  /* in ticks */
+  gint64         interval;
+  gint64         expires;
+
+  GSourceFunc    func;
+  gpointer       data;
+  GDestroyNotify notify;
+
+  guint          dispatching : 1;
+  guint          destroyed : 1;
+};
+
+
+
+static const gchar *wakeup_names[] =
+{
+  "timer-wheel",
+  "activity",
+  "background",
+  "dropdown-grab",
+  "preferences-store",
+  "accel-map-save",
+  "foreground",
+  "throughput",
+  "search",
+  "title",
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (wakeup_names) == TERMINAL_N_WAKEUPS);
+
+
+
+static GSList     *timer_slots[TIMER_SLOTS];
+static GHashTable *timer_table = NULL;
+static guint       timer_last_id = 0;
+static guint       timer_source_id = 0;
+static gint64      timer_source_expires = 0;
+static gint64      timer_last_tick = 0;
+static guint       timer_wakeups[TERMINAL_N_WAKEUPS];
+
+
+
+static inline gint64
+terminal_timer_now (void)
+{
+  return g_get_monotonic_time () / (TERMINAL_TIMER_TICK * 1000);
+}
+
+
+
+static void
+terminal_timer_insert (TerminalTimer *timer)
+{
+  guint slot = timer->expires % TIMER_SLOTS;
+
+  timer_slots[slot] = g_slist_prepend (timer_slots[slot], timer);
+}
+
+
+
+static void
+terminal_timer_free (TerminalTimer *timer)
+{
+  if (timer->notify != NULL)
+    (*timer->notify) (timer->data);
+
+  g_slice_free (TerminalTimer, timer);
+}
+
+
+
+static void
+terminal_timer_schedule (void)
+{
+  TerminalTimer  *timer;
+  GHashTableIter  iter;
+  GSList         *lp;
+  gint64          now;
+  gint64          tick;
+  gint64          expires = G_MAXINT64;
+  gint64          delay;
+
+  if (timer_table == NULL || g_hash_table_size (timer_table) == 0)
+    {
+      /* nothing pending, do not wake up at all */
+      if (timer_source_id != 0)
+        {
+          g_source_remove (timer_source_id);
+          timer_source_id = 0;
+        }
+      return;
+    }
+
+  now = terminal_timer_now ();
+
+  /* find the first slot within one round that has a due timer, starting
+   * with the ticks not dispatched yet, so an overdue timer fires on the
+   * next tick instead of waiting behind later ones */
+  for (tick = MAX (timer_last_tick + 1, now - TIMER_SLOTS + 1);
+       tick <= now + TIMER_SLOTS && expires == G_MAXINT64;
+       tick++)
+    for (lp = timer_slots[tick % TIMER_SLOTS]; lp != NULL; lp = lp->next)
+      {
+        timer = lp->data;
+        if (timer->expires <= tick)
+          expires = MIN (expires, MAX (timer->expires, now + 1));
+      }
+
+  /* only timers beyond one round, sleep until the nearest of them */
+  if (expires == G_MAXINT64)
+    {
+      g_hash_table_iter_init (&iter, timer_table);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &timer))
+        if (!timer->dispatching)
+          expires = MIN (expires, timer->expires);
+
+      if (expires == G_MAXINT64)
+        return;
+    }
+
+  if (timer_source_id != 0)
+    {
+      if (timer_source_expires == expires)
+        return;
+      g_source_remove (timer_source_id);
+    }
+
+  /* wake up on the tick boundary, so all timers of a tick share the wakeup */
+  delay = expires * TERMINAL_TIMER_TICK - g_get_monotonic_time () / 1000;
+  timer_source_expires = expires;
+  timer_source_id = gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT_IDLE, MAX (delay, 0),
+                                                  terminal_timer_dispatch, NULL, NULL);
+}
+
+
+
+static gboolean
+terminal_timer_dispatch (gpointer user_data)
+{
+  TerminalTimer  *timer;
+  GSList        **slot;
+  GSList         *due = NULL;
+  GSList         *lp, *lnext;
+  gint64          now;
+  gint64          tick;
+  gboolean        again;
+
+  timer_source_id = 0;
+  timer_wakeups[TERMINAL_WAKEUP_TIMER_WHEEL]++;
+
+  now = terminal_timer_now ();
+
+  /* collect the expired timers of all the ticks since the last run */
+  for (tick = MAX (timer_last_tick + 1, now - TIMER_SLOTS + 1); tick <= now; tick++)
+    {
+      slot = &timer_slots[tick % TIMER_SLOTS];
+      for (lp = *slot; lp != NULL; lp = lnext)
+        {
+          lnext = lp->next;
+          timer = lp->data;
+          if (timer->expires <= now)
+            {
+              *slot = g_slist_delete_link (*slot, lp);
+              timer->dispatching = TRUE;
+              due = g_slist_prepend (due, timer);
+            }
+        }
+    }
+  timer_last_tick = now;
+
+  for (lp = due; lp != NULL; lp = lp->next)
+    {
+      timer = lp->data;
+
+      /* the timer might be removed by an earlier callback */
+      again = FALSE;
+      if (G_LIKELY (!timer->destroyed))
+        {
+          timer_wakeups[timer->source]++;
+          again = (*timer->func) (timer->data);
+        }
+
+      timer->dispatching = FALSE;
+
+      if (again && !timer->destroyed)
+        {
+          timer->expires = now + timer->interval;
+          terminal_timer_insert (timer);
+        }
+      else
+        {
+          if (!timer->destroyed)
+            g_hash_table_remove (timer_table, GUINT_TO_POINTER (timer->id));
+          terminal_timer_free (timer);
+        }
+    }
+  g_slist_free (due);
+
+  terminal_timer_schedule ();
+
+  return FALSE;
+}
+
+
+
+/**
+ * terminal_timer_add:
+ * @source   : The #TerminalWakeup the timer is accounted to.
+ * @interval : The interval in milliseconds, rounded to the wheel tick.
+ * @func     : Function to call, return %FALSE to stop the timer.
+ * @data     : Data passed to @func and @notify.
+ * @notify   : Function called when the timer is removed or %NULL.
+ *
+ * Adds a timer to the application wide timer wheel. Unlike a regular
+ * #GSource, all timers expiring in the same tick share one main loop
+ * wakeup and an empty wheel does not wake up at all.
+ *
+ * Return value : The timer id for terminal_timer_remove().
+ **/
+guint
+terminal_timer_add (TerminalWakeup  source,
+                    guint           interval,
+                    GSourceFunc     func,
+                    gpointer        data,
+                    GDestroyNotify  notify)
+{
+  TerminalTimer *timer;
+
+  terminal_return_val_if_fail (source < TERMINAL_N_WAKEUPS, 0);
+  terminal_return_val_if_fail (func != NULL, 0);
+
+  if (G_UNLIKELY (timer_table == NULL))
+    timer_table = g_hash_table_new (NULL, NULL);
+
+  /* skip 0 on wrap-around */
+  if (G_UNLIKELY (++timer_last_id == 0))
+    ++timer_last_id;
+
+  timer = g_slice_new0 (TerminalTimer);
+  timer->id = timer_last_id;
+  timer->source = source;
+  timer->interval = MAX (1, (interval + TERMINAL_TIMER_TICK - 1) / TERMINAL_TIMER_TICK);
+  timer->expires = terminal_timer_now () + timer->interval;
+  timer->func = func;
+  timer->data = data;
+  timer->notify = notify;
+
+  g_hash_table_insert (timer_table, GUINT_TO_POINTER (timer->id), timer);
+  terminal_timer_insert (timer);
+
+  terminal_timer_schedule ();
+
+  return timer->id;
+}
+
+
+
+/**
+ * terminal_timer_remove:
+ * @timer_id : A timer id returned by terminal_timer_add().
+ *
+ * Removes the timer and calls its destroy notify.
+ **/
+void
+terminal_timer_remove (guint timer_id)
+{
+  TerminalTimer  *timer;
+  GSList        **slot;
+
+  if (G_UNLIKELY (timer_table == NULL))
+    return;
+
+  timer = g_hash_table_lookup (timer_table, GUINT_TO_POINTER (timer_id));
+  if (G_UNLIKELY (timer == NULL))
+    return;
+
+  g_hash_table_remove (timer_table, GUINT_TO_POINTER (timer_id));
+
+  /* released by terminal_timer_dispatch() */
+  if (timer->dispatching)
+    {
+      timer->destroyed = TRUE;
+      return;
+    }
+
+  slot = &timer_slots[timer->expires % TIMER_SLOTS];
+  *slot = g_slist_remove (*slot, timer);
+  terminal_timer_free (timer);
+
+  terminal_timer_schedule ();
+}
+
+
+
+/**
+ * terminal_timer_get_wakeups:
+ * @source : A #TerminalWakeup.
+ *
+ * Return value : The number of main loop wakeups caused by @source.
+ **/
+guint
+terminal_timer_get_wakeups (TerminalWakeup source)
+{
+  terminal_return_val_if_fail (source < TERMINAL_N_WAKEUPS, 0);
+  return timer_wakeups[source];
+}
+
+
+
+/**
+ * terminal_timer_dump_wakeups:
+ *
+ * Prints the wakeup counters with g_debug().
+ **/
+void
+terminal_timer_dump_wakeups (void)
+{
+  guint n;
+
+  for (n = 0; n < TERMINAL_N_WAKEUPS; n++)
+    g_debug ("Wakeups by %s: %u", wakeup_names[n], timer_wakeups[n]);
+}
@@ -0,0 +1,57 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_TIMER_H
+#define TERMINAL_TIMER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* granularity of the timer wheel in milliseconds */
+#define TERMINAL_TIMER_TICK 100
+
+typedef enum
+{
+  TERMINAL_WAKEUP_TIMER_WHEEL,
+  TERMINAL_WAKEUP_ACTIVITY,
+  TERMINAL_WAKEUP_BACKGROUND,
+  TERMINAL_WAKEUP_DROPDOWN_GRAB,
+  TERMINAL_WAKEUP_PREFERENCES_STORE,
+  TERMINAL_WAKEUP_ACCEL_MAP_SAVE,
+  TERMINAL_WAKEUP_FOREGROUND,
+  TERMINAL_WAKEUP_THROUGHPUT,
+  TERMINAL_WAKEUP_SEARCH,
+  TERMINAL_WAKEUP_TITLE,
+  TERMINAL_N_WAKEUPS
+} TerminalWakeup;
+
+guint terminal_timer_add          (TerminalWakeup  source,
+                                   guint           interval,
+                                   GSourceFunc     func,
+                                   gpointer        data,
+                                   GDestroyNotify  notify);
+
+void  terminal_timer_remove       (guint           timer_id);
+
+guint terminal_timer_get_wakeups  (TerminalWakeup  source);
+
+void  terminal_timer_dump_wakeups (void);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_TIMER_H */
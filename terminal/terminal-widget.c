@@ -31,12 +31,14 @@
 #include <utempter.h>
 #endif
 
+#include <glib-unix.h>
 #include <libxfce4ui/libxfce4ui.h>
 
 #include <terminal/terminal-util.h>
 #include <terminal/terminal-enum-types.h>
 #include <terminal/terminal-marshal.h>
 #include <terminal/terminal-preferences.h>
+#include <terminal/terminal-screen.h>
 #include <terminal/terminal-widget.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-regex.h>
@@ -45,12 +47,21 @@
 
 #define MAILTO          "mailto:"
 
+/* how long the existence of a file path is trusted */
+#define FILE_STAT_TTL   (5 * G_USEC_PER_SEC)
+#define FILE_STAT_MAX   256
+
+/* drops larger than a chunk are written when the pty is writable */
+#define DROP_CHUNK      (16 * 1024)
+#define DROP_PROGRESS   (1024 * 1024)
+
 
 
 enum
 {
   GET_CONTEXT_MENU,
   PASTE_SELECTION_REQUEST,
+  DROP_PROGRESS_CHANGED,
   LAST_SIGNAL,
 };
 
@@ -59,24 +70,57 @@ typedef enum
   PATTERN_TYPE_NONE,
   PATTERN_TYPE_FULL_HTTP,
   PATTERN_TYPE_HTTP,
-  PATTERN_TYPE_EMAIL
+  PATTERN_TYPE_EMAIL,
+  PATTERN_TYPE_FILE_PATH,
+  PATTERN_TYPE_RULE
 } PatternType;
 
 typedef struct
 {
   const gchar *pattern;
+  const gchar *group; /* in REGEX_URL_ANY */
   PatternType  type;
 } TerminalRegexPattern;
 
 static const TerminalRegexPattern regex_patterns[] =
 {
-  { REGEX_URL_AS_IS, PATTERN_TYPE_FULL_HTTP },
-  { REGEX_URL_HTTP,  PATTERN_TYPE_HTTP },
-  { REGEX_URL_FILE,  PATTERN_TYPE_FULL_HTTP },
-  { REGEX_EMAIL,     PATTERN_TYPE_EMAIL },
-  { REGEX_NEWS_MAN,  PATTERN_TYPE_FULL_HTTP },
+  { REGEX_URL_AS_IS, "URL_AS_IS", PATTERN_TYPE_FULL_HTTP },
+  { REGEX_URL_HTTP,  "URL_HTTP",  PATTERN_TYPE_HTTP },
+  { REGEX_URL_FILE,  "URL_FILE",  PATTERN_TYPE_FULL_HTTP },
+  { REGEX_EMAIL,     "EMAIL",     PATTERN_TYPE_EMAIL },
+  { REGEX_NEWS_MAN,  "NEWS_MAN",  PATTERN_TYPE_FULL_HTTP },
+  { REGEX_FILE_PATH, "FILE_PATH", PATTERN_TYPE_FILE_PATH },
 };
 
+typedef struct
+{
+  VteRegex *regex;
+
+  /* copy to expand the template and to check the match limit */
+  GRegex   *gregex;
+
+  gchar    *template;
+  gchar    *cursor;
+  guint     disabled : 1;
+} TerminalMatchRule;
+
+typedef struct
+{
+  /* monotonic time of the result, 0 while the query runs */
+  gint64  checked;
+  guint   exists : 1;
+
+  /* TerminalFileWaiter for the query result */
+  GSList *waiters;
+} TerminalFileStat;
+
+typedef struct
+{
+  TerminalWidget *widget;
+  gint            line;
+  guint           open : 1;
+} TerminalFileWaiter;
+
 
 
 static void     terminal_widget_finalize              (GObject          *object);
@@ -91,9 +135,38 @@ static void     terminal_widget_drag_data_received    (GtkWidget        *widget,
                                                        guint             time);
 static gboolean terminal_widget_key_press_event       (GtkWidget        *widget,
                                                        GdkEventKey      *event);
+static gboolean terminal_widget_motion_notify_event   (GtkWidget        *widget,
+                                                       GdkEventMotion   *event);
 static void     terminal_widget_open_uri              (TerminalWidget   *widget,
                                                        const gchar      *wlink,
                                                        gint              tag);
+static PatternType terminal_widget_get_pattern_type   (TerminalWidget   *widget,
+                                                       gint              tag,
+                                                       const gchar      *match);
+static gchar   *terminal_widget_resolve_path          (TerminalWidget   *widget,
+                                                       const gchar      *match,
+                                                       gboolean          hover,
+                                                       gint             *line);
+static gboolean terminal_widget_file_stat             (TerminalWidget   *widget,
+                                                       const gchar      *path,
+                                                       gint              line,
+                                                       gboolean          open,
+                                                       gboolean         *exists);
+static void     terminal_widget_open_file_at          (TerminalWidget   *widget,
+                                                       const gchar      *path,
+                                                       gint              line);
+static void     terminal_widget_open_file             (TerminalWidget   *widget,
+                                                       const gchar      *match);
+static void     terminal_widget_match_set_clickable   (TerminalWidget   *widget,
+                                                       gint              tag,
+                                                       gboolean          clickable);
+static gint     terminal_widget_match_add             (TerminalWidget   *widget,
+                                                       VteRegex         *regex);
+static void     terminal_widget_regex_table_free      (void);
+static void     terminal_widget_rule_table_free       (void);
+static gchar   *terminal_widget_rule_expand           (TerminalWidget   *widget,
+                                                       gint              tag,
+                                                       const gchar      *match);
 static void     terminal_widget_update_highlight_urls (TerminalWidget   *widget);
 
 
@@ -110,12 +183,55 @@ struct _TerminalWidget
   /*< private >*/
   TerminalPreferences *preferences;
   gint                 regex_tags[G_N_ELEMENTS (regex_patterns)];
+  gint                 regex_any_tag;
+
+  /* tags of the user match rules in rule_table */
+  GArray              *rule_tags;
+  guint                rule_serial;
+
+  /* file path match under the pointer and the tag showing it as missing */
+  gchar               *hover_match;
+  gchar               *hover_path;
+  gint                 hover_tag;
+  gint                 hover_missing_tag;
+
+  /* cell under the pointer when the match was last looked up */
+  glong                hover_column;
+  glong                hover_row;
+
+  /* dropped data not yet written to the pty */
+  GByteArray          *drop_data;
+  gsize                drop_written;
+  guint                drop_watch_id;
+
+  /* no url matching while the output floods the terminal */
+  guint                matching_suspended : 1;
 };
 
 
 
 static guint widget_signals[LAST_SIGNAL];
 
+/* the patterns are large, so they are compiled and jitted once and
+ * shared by all widgets for as long as there are widgets */
+static VteRegex *regex_table[G_N_ELEMENTS (regex_patterns)];
+static gboolean  regex_table_compiled = FALSE;
+static guint     regex_table_users = 0;
+
+/* the single pass pattern, and a copy to find the group of a match */
+static VteRegex *regex_any = NULL;
+static GRegex   *regex_any_groups = NULL;
+static gboolean  regex_any_compiled = FALSE;
+
+/* user defined TerminalMatchRule's from misc-match-rules */
+static GPtrArray *rule_table = NULL;
+static gchar     *rule_table_source = NULL;
+static guint      rule_table_limit = 0;
+static guint      rule_table_serial = 0;
+
+/* path -> TerminalFileStat, shared by all widgets */
+static GHashTable *file_stat_cache = NULL;
+
 
 
 static const GtkTargetEntry targets[] =
@@ -147,9 +263,10 @@ terminal_widget_class_init (TerminalWidgetClass *klass)
   gobject_class->finalize = terminal_widget_finalize;
 
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
-  gtkwidget_class->button_press_event = terminal_widget_button_press_event;
-  gtkwidget_class->drag_data_received = terminal_widget_drag_data_received;
-  gtkwidget_class->key_press_event    = terminal_widget_key_press_event;
+  gtkwidget_class->button_press_event  = terminal_widget_button_press_event;
+  gtkwidget_class->drag_data_received  = terminal_widget_drag_data_received;
+  gtkwidget_class->key_press_event     = terminal_widget_key_press_event;
+  gtkwidget_class->motion_notify_event = terminal_widget_motion_notify_event;
 
   /**
    * TerminalWidget::get-context-menu:
@@ -172,6 +289,21 @@ terminal_widget_class_init (TerminalWidgetClass *klass)
                   0, NULL, NULL,
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
+
+  /**
+   * TerminalWidget::drop-progress:
+   *
+   * Emitted while a large drop is written to the pty, the last
+   * emission has written equal to total.
+   **/
+  widget_signals[DROP_PROGRESS_CHANGED] =
+    g_signal_new (I_("drop-progress"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  _terminal_marshal_VOID__UINT64_UINT64,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_UINT64, G_TYPE_UINT64);
 }
 
 
@@ -184,6 +316,12 @@ terminal_widget_init (TerminalWidget *widget)
 
   /* unset tags */
   memset (widget->regex_tags, -1, sizeof (widget->regex_tags));
+  widget->regex_any_tag = -1;
+  widget->hover_tag = -1;
+  widget->hover_missing_tag = -1;
+  widget->hover_column = widget->hover_row = -1;
+  widget->rule_tags = g_array_new (FALSE, FALSE, sizeof (gint));
+  regex_table_users++;
 
   /* setup Drag'n'Drop support */
   gtk_drag_dest_set (GTK_WIDGET (widget),
@@ -196,6 +334,12 @@ terminal_widget_init (TerminalWidget *widget)
   /* monitor the misc-highlight-urls setting */
   g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-highlight-urls",
                             G_CALLBACK (terminal_widget_update_highlight_urls), widget);
+  g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-highlight-urls-single-pass",
+                            G_CALLBACK (terminal_widget_update_highlight_urls), widget);
+  g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-match-rules",
+                            G_CALLBACK (terminal_widget_update_highlight_urls), widget);
+  g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-match-rule-limit",
+                            G_CALLBACK (terminal_widget_update_highlight_urls), widget);
 
   /* apply the initial misc-highlight-urls setting */
   terminal_widget_update_highlight_urls (widget);
@@ -214,12 +358,36 @@ terminal_widget_finalize (GObject *object)
     utempter_remove_record (vte_pty_get_fd (pty));
 #endif
 
-  /* disconnect the misc-highlight-urls watch */
+  /* disconnect the misc-highlight-urls watches */
   g_signal_handlers_disconnect_by_func (G_OBJECT (widget->preferences), G_CALLBACK (terminal_widget_update_highlight_urls), widget);
 
   /* disconnect from the preferences */
   g_object_unref (G_OBJECT (widget->preferences));
 
+  g_free (widget->hover_match);
+  g_free (widget->hover_path);
+  g_array_free (widget->rule_tags, TRUE);
+
+  /* stop writing a drop */
+  if (widget->drop_watch_id != 0)
+    g_source_remove (widget->drop_watch_id);
+  if (widget->drop_data != NULL)
+    g_byte_array_free (widget->drop_data, TRUE);
+
+  /* release the shared patterns with the last widget */
+  if (--regex_table_users == 0)
+    {
+      terminal_widget_regex_table_free ();
+      terminal_widget_rule_table_free ();
+
+      /* the waiters hold a reference on their widget, so none are left */
+      if (file_stat_cache != NULL)
+        {
+          g_hash_table_destroy (file_stat_cache);
+          file_stat_cache = NULL;
+        }
+    }
+
   (*G_OBJECT_CLASS (terminal_widget_parent_class)->finalize) (object);
 }
 
@@ -290,7 +458,7 @@ terminal_widget_context_menu (TerminalWidget *widget,
   GtkWidget   *item_separator = NULL;
   GList       *children;
   gchar       *match;
-  guint        id, i;
+  guint        id;
   gint         tag;
   PatternType  pattern_type = PATTERN_TYPE_NONE;
 
@@ -315,12 +483,7 @@ terminal_widget_context_menu (TerminalWidget *widget,
       g_list_free (children);
 
       /* lookup the pattern type */
-      for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
-        if (widget->regex_tags[i] == tag)
-          {
-            pattern_type = regex_patterns[i].type;
-            break;
-          }
+      pattern_type = terminal_widget_get_pattern_type (widget, tag, match);
       terminal_return_if_fail (pattern_type != PATTERN_TYPE_NONE);
 
       /* create menu items with appriorate labels */
@@ -329,6 +492,11 @@ terminal_widget_context_menu (TerminalWidget *widget,
           item_copy = gtk_menu_item_new_with_label (_("Copy Email Address"));
           item_open = gtk_menu_item_new_with_label (_("Compose Email"));
         }
+      else if (pattern_type == PATTERN_TYPE_FILE_PATH)
+        {
+          item_copy = gtk_menu_item_new_with_label (_("Copy Path"));
+          item_open = gtk_menu_item_new_with_label (_("Open File"));
+        }
       else
         {
           item_copy = gtk_menu_item_new_with_label (_("Copy Link Address"));
@@ -458,6 +626,85 @@ terminal_widget_button_press_event (GtkWidget       *widget,
 
 
 
+static void
+terminal_widget_drop_finish (TerminalWidget *widget)
+{
+  guint64 total = widget->drop_data->len;
+
+  g_byte_array_free (widget->drop_data, TRUE);
+  widget->drop_data = NULL;
+  widget->drop_written = 0;
+
+  if (total > DROP_PROGRESS)
+    g_signal_emit (G_OBJECT (widget), widget_signals[DROP_PROGRESS_CHANGED], 0, total, total);
+}
+
+
+
+static gboolean
+terminal_widget_drop_write (gint         fd,
+                            GIOCondition condition,
+                            gpointer     user_data)
+{
+  TerminalWidget *widget = TERMINAL_WIDGET (user_data);
+  gsize           length;
+
+  terminal_assert (widget->drop_data != NULL);
+
+  if ((condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) == 0)
+    {
+      /* write a chunk, the pty has room for it */
+      length = MIN (DROP_CHUNK, widget->drop_data->len - widget->drop_written);
+      vte_terminal_feed_child (VTE_TERMINAL (widget),
+                               (const gchar *) widget->drop_data->data + widget->drop_written,
+                               length);
+      widget->drop_written += length;
+
+      if (widget->drop_written < widget->drop_data->len)
+        {
+          if (widget->drop_data->len > DROP_PROGRESS)
+            g_signal_emit (G_OBJECT (widget), widget_signals[DROP_PROGRESS_CHANGED], 0,
+                           (guint64) widget->drop_written, (guint64) widget->drop_data->len);
+          return TRUE;
+        }
+    }
+
+  /* done or the child is gone */
+  widget->drop_watch_id = 0;
+  terminal_widget_drop_finish (widget);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_widget_drop_feed (TerminalWidget *widget,
+                           const gchar    *data,
+                           gsize           length)
+{
+  VtePty *pty = vte_terminal_get_pty (VTE_TERMINAL (widget));
+
+  /* small drops are written right away, unless they would pass a large one */
+  if (widget->drop_data == NULL && (length <= DROP_CHUNK || pty == NULL))
+    {
+      vte_terminal_feed_child (VTE_TERMINAL (widget), data, length);
+      return;
+    }
+
+  if (widget->drop_data == NULL)
+    widget->drop_data = g_byte_array_sized_new (length);
+  g_byte_array_append (widget->drop_data, (const guint8 *) data, length);
+
+  if (widget->drop_watch_id == 0)
+    {
+      widget->drop_watch_id = g_unix_fd_add (vte_pty_get_fd (pty), G_IO_OUT,
+                                             terminal_widget_drop_write, widget);
+    }
+}
+
+
+
 static void
 terminal_widget_drag_data_received (GtkWidget        *widget,
                                     GdkDragContext   *context,
@@ -487,7 +734,7 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
       if (G_LIKELY (text != NULL))
         {
           if (G_LIKELY (*text != '\0'))
-            vte_terminal_feed_child (VTE_TERMINAL (widget), text, strlen (text));
+            terminal_widget_drop_feed (TERMINAL_WIDGET (widget), text, strlen (text));
           g_free (text);
         }
       break;
@@ -500,9 +747,9 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
         }
       else
         {
-          vte_terminal_feed_child (VTE_TERMINAL (widget),
-                                   (const gchar *) gtk_selection_data_get_data (selection_data),
-                                   gtk_selection_data_get_length (selection_data));
+          terminal_widget_drop_feed (TERMINAL_WIDGET (widget),
+                                     (const gchar *) gtk_selection_data_get_data (selection_data),
+                                     gtk_selection_data_get_length (selection_data));
         }
       break;
 
@@ -548,27 +795,29 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
           uris = g_uri_list_extract_uris (text);
           g_free (text);
 
-          /* translate all file:-URIs to quoted file names */
+          /* translate all file:-URIs to quoted file names, joined by spaces */
+          str = g_string_sized_new (gtk_selection_data_get_length (selection_data));
           for (n = 0; uris[n] != NULL; ++n)
             {
               /* check if we have a local file here */
               filename = g_filename_from_uri (uris[n], NULL, NULL);
               if (G_LIKELY (filename != NULL))
                 {
-                  /* release the file:-URI */
-                  g_free (uris[n]);
-
                   /* quote the file name (for the shell) */
-                  uris[n] = g_shell_quote (filename);
+                  text = g_shell_quote (filename);
+                  g_string_append (str, text);
                   g_free (filename);
+                  g_free (text);
                 }
+              else
+                g_string_append (str, uris[n]);
+
+              g_string_append_c (str, ' ');
             }
 
-          text = g_strjoinv (" ", uris);
-          vte_terminal_feed_child (VTE_TERMINAL (widget), text, strlen (text));
-          vte_terminal_feed_child (VTE_TERMINAL (widget), " ", 1);
+          terminal_widget_drop_feed (TERMINAL_WIDGET (widget), str->str, str->len);
+          g_string_free (str, TRUE);
           g_strfreev (uris);
-          g_free (text);
         }
       break;
 
@@ -664,6 +913,77 @@ terminal_widget_key_press_event (GtkWidget    *widget,
 
 
 
+static gboolean
+terminal_widget_motion_notify_event (GtkWidget      *widget,
+                                     GdkEventMotion *event)
+{
+  TerminalWidget *terminal_widget = TERMINAL_WIDGET (widget);
+  GtkAdjustment  *adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (widget));
+  GtkBorder       padding;
+  gboolean        exists = TRUE;
+  gchar          *match;
+  gchar          *path = NULL;
+  gint            tag = -1;
+  gdouble         x, y;
+  glong           column, row;
+  gboolean        result;
+
+  result = (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->motion_notify_event) (widget, event);
+
+  /* vte already tracks the match under the pointer, only look it up
+   * again once the pointer moved to another cell */
+  gtk_style_context_get_padding (gtk_widget_get_style_context (widget),
+                                 gtk_widget_get_state_flags (widget), &padding);
+  x = event->x - padding.left;
+  y = event->y - padding.top;
+  column = x < 0 ? -1 : (glong) (x / MAX (vte_terminal_get_char_width (VTE_TERMINAL (widget)), 1));
+  row = y < 0 ? -1 : (glong) (y / MAX (vte_terminal_get_char_height (VTE_TERMINAL (widget)), 1))
+                     + (glong) gtk_adjustment_get_value (adjustment);
+  if (column == terminal_widget->hover_column && row == terminal_widget->hover_row)
+    return result;
+  terminal_widget->hover_column = column;
+  terminal_widget->hover_row = row;
+
+  /* nothing to do while the pointer stays on the same match */
+  match = vte_terminal_match_check_event (VTE_TERMINAL (widget), (GdkEvent *) event, &tag);
+  if (tag == terminal_widget->hover_tag && g_strcmp0 (match, terminal_widget->hover_match) == 0)
+    {
+      g_free (match);
+      return result;
+    }
+
+  /* show missing file paths with a text cursor, the existence is
+   * checked in the background and updated from the cache */
+  if (match != NULL && terminal_widget_get_pattern_type (terminal_widget, tag, match) == PATTERN_TYPE_FILE_PATH)
+    {
+      path = terminal_widget_resolve_path (terminal_widget, match, TRUE, NULL);
+      if (path != NULL)
+        terminal_widget_file_stat (terminal_widget, path, 0, FALSE, &exists);
+    }
+
+  g_free (terminal_widget->hover_match);
+  terminal_widget->hover_match = match;
+  g_free (terminal_widget->hover_path);
+  terminal_widget->hover_path = path;
+  terminal_widget->hover_tag = tag;
+
+  if (terminal_widget->hover_missing_tag != -1)
+    {
+      terminal_widget_match_set_clickable (terminal_widget, terminal_widget->hover_missing_tag, TRUE);
+      terminal_widget->hover_missing_tag = -1;
+    }
+
+  if (!exists)
+    {
+      terminal_widget_match_set_clickable (terminal_widget, tag, FALSE);
+      terminal_widget->hover_missing_tag = tag;
+    }
+
+  return result;
+}
+
+
+
 static void
 terminal_widget_open_uri (TerminalWidget *widget,
                           const gchar    *wlink,
@@ -672,48 +992,789 @@ terminal_widget_open_uri (TerminalWidget *widget,
   GtkWindow *window = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (widget)));
   GError    *error = NULL;
   gchar     *uri;
-  guint      i;
 
-  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+  /* handle the pattern type */
+  switch (terminal_widget_get_pattern_type (widget, tag, wlink))
+    {
+      case PATTERN_TYPE_FULL_HTTP:
+        uri = g_strdup (wlink);
+        break;
+
+      case PATTERN_TYPE_HTTP:
+        uri = g_strconcat ("http://", wlink, NULL);
+        break;
+
+      case PATTERN_TYPE_EMAIL:
+        uri = strncmp (wlink, MAILTO, strlen (MAILTO)) == 0
+            ? g_strdup (wlink) : g_strconcat (MAILTO, wlink, NULL);
+        break;
+
+      case PATTERN_TYPE_FILE_PATH:
+        terminal_widget_open_file (widget, wlink);
+        return;
+
+      case PATTERN_TYPE_RULE:
+        uri = terminal_widget_rule_expand (widget, tag, wlink);
+        if (G_UNLIKELY (uri == NULL))
+          return;
+        break;
+
+      default:
+        g_warning ("Invalid tag specified while trying to open link \"%s\".", wlink);
+        return;
+    }
+
+  /* try to open the URI with the responsible application */
+  if (!gtk_show_uri_on_window (window, uri, gtk_get_current_event_time (), &error))
+    {
+      /* tell the user that we were unable to open the responsible application */
+      xfce_dialog_show_error (window, error, _("Failed to open the URL '%s'"), uri);
+      g_error_free (error);
+    }
+
+  g_free (uri);
+}
+
+
+
+static PatternType
+terminal_widget_get_pattern_type (TerminalWidget *widget,
+                                  gint            tag,
+                                  const gchar    *match)
+{
+  GMatchInfo  *info;
+  PatternType  pattern_type = PATTERN_TYPE_NONE;
+  gint         start;
+  guint        i;
+
+  if (tag != widget->regex_any_tag)
     {
       /* lookup the tag in our tags */
-      if (widget->regex_tags[i] != tag)
-        continue;
+      for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+        if (widget->regex_tags[i] == tag)
+          return regex_patterns[i].type;
 
-      /* handle the pattern type */
-      switch (regex_patterns[i].type)
-        {
-          case PATTERN_TYPE_FULL_HTTP:
-            uri = g_strdup (wlink);
-            break;
+      for (i = 0; i < widget->rule_tags->len; i++)
+        if (g_array_index (widget->rule_tags, gint, i) == tag)
+          return PATTERN_TYPE_RULE;
 
-          case PATTERN_TYPE_HTTP:
-            uri = g_strconcat ("http://", wlink, NULL);
-            break;
+      return PATTERN_TYPE_NONE;
+    }
+
+  if (G_UNLIKELY (regex_any_groups == NULL))
+    return PATTERN_TYPE_NONE;
 
-          case PATTERN_TYPE_EMAIL:
-            uri = strncmp (wlink, MAILTO, strlen (MAILTO)) == 0
-                ? g_strdup (wlink) : g_strconcat (MAILTO, wlink, NULL);
+  /* the match starts at the text vte returned, the first group that
+   * took part in it is the pattern vte matched */
+  if (g_regex_match (regex_any_groups, match, G_REGEX_MATCH_ANCHORED, &info))
+    {
+      for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+        if (g_match_info_fetch_named_pos (info, regex_patterns[i].group, &start, NULL)
+            && start != -1)
+          {
+            pattern_type = regex_patterns[i].type;
             break;
+          }
+    }
+  g_match_info_free (info);
+
+  return pattern_type;
+}
 
-          default:
-            g_warning ("Invalid tag specified while trying to open link \"%s\".", wlink);
-            return;
+
+
+static gchar *
+terminal_widget_resolve_path (TerminalWidget *widget,
+                              const gchar    *match,
+                              gboolean        hover,
+                              gint           *line)
+{
+  GtkWidget   *screen;
+  const gchar *directory;
+  gchar       *name;
+  gchar       *colon;
+  gchar       *path;
+
+  /* split off the line and column, path segments have no colons */
+  name = g_strdup (match);
+  colon = strchr (name, ':');
+  if (colon != NULL)
+    *colon++ = '\0';
+  if (line != NULL)
+    *line = colon != NULL ? (gint) g_ascii_strtoll (colon, NULL, 10) : 0;
+
+  if (name[0] == '~')
+    path = g_build_filename (g_get_home_dir (), name + 1, NULL);
+  else if (g_path_is_absolute (name))
+    path = g_strdup (name);
+  else
+    {
+      /* relative to the working directory of the tab, hovering
+       * skips the path until the directory is known */
+      path = NULL;
+      screen = gtk_widget_get_ancestor (GTK_WIDGET (widget), TERMINAL_TYPE_SCREEN);
+      if (G_LIKELY (screen != NULL))
+        {
+          if (hover)
+            directory = terminal_screen_peek_working_directory (TERMINAL_SCREEN (screen));
+          else
+            directory = terminal_screen_get_working_directory (TERMINAL_SCREEN (screen));
+          if (G_LIKELY (directory != NULL))
+            path = g_build_filename (directory, name, NULL);
         }
+    }
+
+  g_free (name);
+
+  return path;
+}
+
+
+
+static void
+terminal_widget_file_stat_free (gpointer data)
+{
+  TerminalFileStat *file_stat = data;
+
+  terminal_assert (file_stat->waiters == NULL);
+  g_slice_free (TerminalFileStat, file_stat);
+}
+
+
+
+static gboolean
+terminal_widget_file_stat_expired (gpointer key,
+                                   gpointer value,
+                                   gpointer user_data)
+{
+  TerminalFileStat *file_stat = value;
+
+  return file_stat->checked != 0 && *((gint64 *) user_data) - file_stat->checked >= FILE_STAT_TTL;
+}
+
+
+
+static void
+terminal_widget_file_stat_finished (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  TerminalFileWaiter *waiter;
+  TerminalFileStat   *file_stat;
+  GFileInfo          *info;
+  GError             *error = NULL;
+  GtkWidget          *toplevel;
+  gchar              *path = user_data;
+  GSList             *waiters;
+  GSList             *lp;
+
+  info = g_file_query_info_finish (G_FILE (object), result, &error);
+
+  /* the cache is gone with the last widget */
+  file_stat = file_stat_cache != NULL ? g_hash_table_lookup (file_stat_cache, path) : NULL;
+  if (G_LIKELY (file_stat != NULL && file_stat->checked == 0))
+    {
+      file_stat->checked = g_get_monotonic_time ();
+      file_stat->exists = info != NULL;
+
+      waiters = file_stat->waiters;
+      file_stat->waiters = NULL;
 
-      /* try to open the URI with the responsible application */
-      if (!gtk_show_uri_on_window (window, uri, gtk_get_current_event_time (), &error))
+      for (lp = waiters; lp != NULL; lp = lp->next)
         {
-          /* tell the user that we were unable to open the responsible application */
-          xfce_dialog_show_error (window, error, _("Failed to open the URL '%s'"), uri);
-          g_error_free (error);
+          waiter = lp->data;
+          toplevel = gtk_widget_get_toplevel (GTK_WIDGET (waiter->widget));
+
+          /* the tab was closed or is being moved since the click */
+          if (gtk_widget_in_destruction (GTK_WIDGET (waiter->widget))
+              || !gtk_widget_is_toplevel (toplevel) || !GTK_IS_WINDOW (toplevel))
+            ;
+          else if (waiter->open && info != NULL)
+            terminal_widget_open_file_at (waiter->widget, path, waiter->line);
+          else if (waiter->open)
+            xfce_dialog_show_error (GTK_WINDOW (toplevel), error,
+                                    _("Failed to open the file '%s'"), path);
+          else if (info == NULL && waiter->widget->hover_missing_tag == -1
+                   && g_strcmp0 (waiter->widget->hover_path, path) == 0)
+            {
+              /* the pointer is still over the missing path */
+              waiter->widget->hover_missing_tag = waiter->widget->hover_tag;
+              terminal_widget_match_set_clickable (waiter->widget, waiter->widget->hover_tag, FALSE);
+            }
+
+          g_object_unref (G_OBJECT (waiter->widget));
+          g_slice_free (TerminalFileWaiter, waiter);
         }
+      g_slist_free (waiters);
+    }
+
+  if (info != NULL)
+    g_object_unref (G_OBJECT (info));
+  else
+    g_error_free (error);
+  g_free (path);
+}
+
+
+
+static gboolean
+terminal_widget_file_stat (TerminalWidget *widget,
+                           const gchar    *path,
+                           gint            line,
+                           gboolean        open,
+                           gboolean       *exists)
+{
+  TerminalFileWaiter *waiter;
+  TerminalFileStat   *file_stat;
+  GFile              *file;
+  GSList             *lp;
+  gboolean            pending;
+  gint64              now = g_get_monotonic_time ();
+
+  if (G_UNLIKELY (file_stat_cache == NULL))
+    file_stat_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, terminal_widget_file_stat_free);
+
+  /* a click asks again for a missing file, it might have been
+   * written since the last hover */
+  file_stat = g_hash_table_lookup (file_stat_cache, path);
+  if (file_stat != NULL && file_stat->checked != 0 && now - file_stat->checked < FILE_STAT_TTL
+      && (file_stat->exists || !open))
+    {
+      /* cache hit */
+      *exists = file_stat->exists;
+      return TRUE;
+    }
+
+  /* assume it exists until the query tells otherwise */
+  *exists = TRUE;
+
+  pending = file_stat != NULL && file_stat->checked == 0;
+  if (file_stat == NULL)
+    {
+      if (g_hash_table_size (file_stat_cache) >= FILE_STAT_MAX)
+        g_hash_table_foreach_remove (file_stat_cache, terminal_widget_file_stat_expired, &now);
+
+      file_stat = g_slice_new0 (TerminalFileStat);
+      g_hash_table_insert (file_stat_cache, g_strdup (path), file_stat);
+    }
+
+  /* a hover only needs one waiter per widget */
+  for (lp = file_stat->waiters; !open && lp != NULL; lp = lp->next)
+    if (((TerminalFileWaiter *) lp->data)->widget == widget && !((TerminalFileWaiter *) lp->data)->open)
+      break;
+
+  if (open || lp == NULL)
+    {
+      waiter = g_slice_new0 (TerminalFileWaiter);
+      waiter->widget = g_object_ref (G_OBJECT (widget));
+      waiter->line = line;
+      waiter->open = open;
+      file_stat->waiters = g_slist_prepend (file_stat->waiters, waiter);
+    }
+
+  if (!pending)
+    {
+      /* stat() on a slow file system blocks a gio worker, not us */
+      file_stat->checked = 0;
+      file = g_file_new_for_path (path);
+      g_file_query_info_async (file, G_FILE_ATTRIBUTE_STANDARD_TYPE, G_FILE_QUERY_INFO_NONE,
+                               G_PRIORITY_DEFAULT, NULL, terminal_widget_file_stat_finished,
+                               g_strdup (path));
+      g_object_unref (G_OBJECT (file));
+    }
+
+  return FALSE;
+}
 
+
+
+static void
+terminal_widget_open_file_at (TerminalWidget *widget,
+                              const gchar    *path,
+                              gint            line)
+{
+  GtkWindow    *window = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (widget)));
+  GError       *error = NULL;
+  gchar        *editor;
+  gchar       **argv = NULL;
+  gchar        *uri;
+  gchar        *number;
+  GString      *arg;
+  const gchar  *p;
+  gboolean      has_file = FALSE;
+  gint          n;
+
+  g_object_get (G_OBJECT (widget->preferences), "misc-editor-command", &editor, NULL);
+
+  if (!IS_STRING (editor))
+    {
+      /* the default application does not know about lines */
+      uri = g_filename_to_uri (path, NULL, &error);
+      if (uri != NULL)
+        gtk_show_uri_on_window (window, uri, gtk_get_current_event_time (), &error);
       g_free (uri);
+    }
+  else if (g_shell_parse_argv (editor, NULL, &argv, &error))
+    {
+      /* substitute after splitting, so the path needs no quoting */
+      number = g_strdup_printf ("%d", MAX (line, 1));
+      for (n = 0; argv[n] != NULL; n++)
+        {
+          arg = g_string_new (NULL);
+          for (p = argv[n]; *p != '\0'; p++)
+            {
+              if (p[0] == '%' && p[1] == 'f')
+                {
+                  g_string_append (arg, path);
+                  has_file = TRUE;
+                  p++;
+                }
+              else if (p[0] == '%' && p[1] == 'l')
+                {
+                  g_string_append (arg, number);
+                  p++;
+                }
+              else
+                g_string_append_c (arg, *p);
+            }
+          g_free (argv[n]);
+          argv[n] = g_string_free (arg, FALSE);
+        }
+      g_free (number);
+
+      if (!has_file)
+        {
+          argv = g_renew (gchar *, argv, n + 2);
+          argv[n] = g_strdup (path);
+          argv[n + 1] = NULL;
+        }
 
-      /* done */
+      g_spawn_async (NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error);
+      g_strfreev (argv);
+    }
+
+  if (G_UNLIKELY (error != NULL))
+    {
+      xfce_dialog_show_error (window, error, _("Failed to open the file '%s'"), path);
+      g_error_free (error);
+    }
+
+  g_free (editor);
+}
+
+
+
+static void
+terminal_widget_open_file (TerminalWidget *widget,
+                           const gchar    *match)
+{
+  gboolean  exists;
+  gchar    *path;
+  gint      line;
+
+  path = terminal_widget_resolve_path (widget, match, FALSE, &line);
+  if (G_UNLIKELY (path == NULL))
+    return;
+
+  /* opened from the query callback if not cached */
+  if (terminal_widget_file_stat (widget, path, line, TRUE, &exists) && exists)
+    terminal_widget_open_file_at (widget, path, line);
+
+  g_free (path);
+}
+
+
+
+static VteRegex *
+terminal_widget_regex_new (const gchar *pattern,
+                           guint32      flags)
+{
+  VteRegex *regex;
+  GError   *error = NULL;
+
+  /* build the regex */
+  regex = vte_regex_new_for_match (pattern, -1,
+                                   flags | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE,
+                                   &error);
+
+  if (error == NULL && (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &error) ||
+                        !vte_regex_jit (regex, PCRE2_JIT_PARTIAL_SOFT, &error)))
+    {
+      g_critical ("Failed to JIT regular expression '%s': %s\n", pattern, error->message);
+      g_clear_error (&error);
+    }
+  if (G_UNLIKELY (error != NULL))
+    {
+      g_critical ("Failed to parse regular expression '%s': %s", pattern, error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  return regex;
+}
+
+
+
+static void
+terminal_widget_regex_table_compile (void)
+{
+  guint  i;
+#ifdef G_ENABLE_DEBUG
+  gint64 start = g_get_monotonic_time ();
+#endif
+
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    regex_table[i] = terminal_widget_regex_new (regex_patterns[i].pattern, PCRE2_CASELESS);
+
+  /* failed patterns are not tried again */
+  regex_table_compiled = TRUE;
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Compiled %u url patterns in %.1f ms", i, (g_get_monotonic_time () - start) / 1000.0);
+#endif
+}
+
+
+
+static void
+terminal_widget_regex_any_compile (void)
+{
+  GError *error = NULL;
+#ifdef G_ENABLE_DEBUG
+  gint64  start = g_get_monotonic_time ();
+#endif
+
+  regex_any = terminal_widget_regex_new (REGEX_URL_ANY, PCRE2_CASELESS);
+  if (G_LIKELY (regex_any != NULL))
+    {
+      /* only used on the text of a match when it is clicked */
+      regex_any_groups = g_regex_new (REGEX_URL_ANY, G_REGEX_CASELESS, 0, &error);
+      if (G_UNLIKELY (regex_any_groups == NULL))
+        {
+          g_critical ("Failed to parse regular expression '%s': %s", REGEX_URL_ANY, error->message);
+          g_error_free (error);
+          vte_regex_unref (regex_any);
+          regex_any = NULL;
+        }
+    }
+
+  regex_any_compiled = TRUE;
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Compiled the single pass url pattern in %.1f ms", (g_get_monotonic_time () - start) / 1000.0);
+#endif
+}
+
+
+
+static void
+terminal_widget_regex_table_free (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    if (regex_table[i] != NULL)
+      {
+        vte_regex_unref (regex_table[i]);
+        regex_table[i] = NULL;
+      }
+
+  if (regex_any != NULL)
+    {
+      vte_regex_unref (regex_any);
+      regex_any = NULL;
+    }
+  if (regex_any_groups != NULL)
+    {
+      g_regex_unref (regex_any_groups);
+      regex_any_groups = NULL;
+    }
+
+  regex_table_compiled = FALSE;
+  regex_any_compiled = FALSE;
+}
+
+
+
+static void
+terminal_widget_rule_free (gpointer data)
+{
+  TerminalMatchRule *rule = data;
+
+  if (rule->regex != NULL)
+    vte_regex_unref (rule->regex);
+  if (rule->gregex != NULL)
+    g_regex_unref (rule->gregex);
+  g_free (rule->template);
+  g_free (rule->cursor);
+  g_slice_free (TerminalMatchRule, rule);
+}
+
+
+
+static void
+terminal_widget_rule_table_free (void)
+{
+  if (rule_table != NULL)
+    {
+      g_ptr_array_unref (rule_table);
+      rule_table = NULL;
+    }
+
+  g_free (rule_table_source);
+  rule_table_source = NULL;
+  rule_table_serial++;
+}
+
+
+
+static void
+terminal_widget_rule_disable (TerminalMatchRule *rule,
+                              const GError      *error)
+{
+  g_warning ("Disabled match rule \"%s\": %s", g_regex_get_pattern (rule->gregex), error->message);
+  rule->disabled = TRUE;
+}
+
+
+
+static void
+terminal_widget_rule_table_add (const gchar *definition)
+{
+  TerminalMatchRule  *rule;
+  GError             *error = NULL;
+  GString            *probe;
+  gchar             **fields;
+  gchar              *pattern;
+  guint               i, n;
+
+  /* probes with long runs that make bad patterns backtrack */
+  static const gchar *probe_units[] = { "a", "0", " ", "a ", "a.", "a-", "a/", "(", "\"" };
+
+  fields = g_strsplit (definition, "|", 3);
+  if (g_strv_length (fields) != 3 || !IS_STRING (fields[2]))
+    {
+      g_warning ("Invalid match rule \"%s\", expected template|cursor|regex", definition);
+      g_strfreev (fields);
       return;
     }
+
+  /* the budget is part of the pattern, so it holds in vte as well */
+  pattern = g_strdup_printf ("(*LIMIT_MATCH=%u)%s", rule_table_limit, fields[2]);
+
+  rule = g_slice_new0 (TerminalMatchRule);
+  rule->template = g_strdup (fields[0]);
+  rule->cursor = IS_STRING (fields[1]) ? g_strdup (fields[1]) : NULL;
+  rule->regex = terminal_widget_regex_new (pattern, 0);
+  if (G_LIKELY (rule->regex != NULL))
+    {
+      rule->gregex = g_regex_new (pattern, G_REGEX_OPTIMIZE, 0, &error);
+      if (G_UNLIKELY (rule->gregex == NULL))
+        {
+          g_warning ("Failed to parse match rule \"%s\": %s", fields[2], error->message);
+          g_error_free (error);
+          rule->disabled = TRUE;
+        }
+    }
+  else
+    rule->disabled = TRUE;
+
+  /* disable rules exceeding the budget before they reach the screen */
+  for (i = 0; !rule->disabled && i < G_N_ELEMENTS (probe_units); i++)
+    {
+      probe = g_string_new (NULL);
+      for (n = 0; n < 4096; n += strlen (probe_units[i]))
+        g_string_append (probe, probe_units[i]);
+      g_string_append_c (probe, '!');
+
+      if (!g_regex_match_full (rule->gregex, probe->str, probe->len, 0, 0, NULL, &error)
+          && error != NULL)
+        {
+          terminal_widget_rule_disable (rule, error);
+          g_error_free (error);
+          error = NULL;
+        }
+
+      g_string_free (probe, TRUE);
+    }
+
+  g_ptr_array_add (rule_table, rule);
+
+  g_free (pattern);
+  g_strfreev (fields);
+}
+
+
+
+static void
+terminal_widget_rule_table_update (const gchar *source,
+                                   guint        limit)
+{
+  GString     *definition;
+  const gchar *p;
+#ifdef G_ENABLE_DEBUG
+  gint64       start = g_get_monotonic_time ();
+#endif
+
+  if (g_strcmp0 (source, rule_table_source) == 0 && limit == rule_table_limit)
+    return;
+
+  terminal_widget_rule_table_free ();
+
+  rule_table_source = g_strdup (source);
+  rule_table_limit = limit;
+  rule_table = g_ptr_array_new_with_free_func (terminal_widget_rule_free);
+
+  if (!IS_STRING (source))
+    return;
+
+  /* split the rules on unescaped semicolons */
+  definition = g_string_new (NULL);
+  for (p = source;; p++)
+    {
+      if (p[0] == '\\' && p[1] == ';')
+        {
+          g_string_append_c (definition, ';');
+          p++;
+        }
+      else if (*p == ';' || *p == '\0')
+        {
+          if (definition->len > 0)
+            terminal_widget_rule_table_add (definition->str);
+          g_string_truncate (definition, 0);
+
+          if (*p == '\0')
+            break;
+        }
+      else
+        g_string_append_c (definition, *p);
+    }
+  g_string_free (definition, TRUE);
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Compiled %u match rules in %.1f ms", rule_table->len, (g_get_monotonic_time () - start) / 1000.0);
+#endif
+}
+
+
+
+static gchar *
+terminal_widget_rule_expand (TerminalWidget *widget,
+                             gint            tag,
+                             const gchar    *match)
+{
+  TerminalMatchRule *rule = NULL;
+  GMatchInfo        *info;
+  GError            *error = NULL;
+  gchar             *uri = NULL;
+  guint              i;
+
+  if (widget->rule_serial == rule_table_serial && rule_table != NULL)
+    for (i = 0; i < widget->rule_tags->len && i < rule_table->len; i++)
+      if (g_array_index (widget->rule_tags, gint, i) == tag)
+        {
+          rule = g_ptr_array_index (rule_table, i);
+          break;
+        }
+
+  if (G_UNLIKELY (rule == NULL || rule->disabled))
+    return NULL;
+
+  /* match again for the groups of the template */
+  if (g_regex_match_full (rule->gregex, match, -1, 0, G_REGEX_MATCH_ANCHORED, &info, &error))
+    uri = g_match_info_expand_references (info, rule->template, NULL);
+  g_match_info_free (info);
+
+  if (G_UNLIKELY (error != NULL))
+    {
+      terminal_widget_rule_disable (rule, error);
+      g_error_free (error);
+
+      /* let all widgets drop the rule */
+      g_object_notify (G_OBJECT (widget->preferences), "misc-match-rules");
+    }
+
+  return uri;
+}
+
+
+
+static void
+terminal_widget_update_rules (TerminalWidget *widget,
+                              gboolean        highlight_urls)
+{
+  TerminalMatchRule *rule;
+  gint              *tag;
+  guint              i, n_rules;
+
+  /* tags of an old table */
+  if (widget->rule_serial != rule_table_serial)
+    {
+      for (i = 0; i < widget->rule_tags->len; i++)
+        if (g_array_index (widget->rule_tags, gint, i) != -1)
+          vte_terminal_match_remove (VTE_TERMINAL (widget), g_array_index (widget->rule_tags, gint, i));
+      g_array_set_size (widget->rule_tags, 0);
+      widget->rule_serial = rule_table_serial;
+    }
+
+  n_rules = rule_table != NULL ? rule_table->len : 0;
+  for (i = widget->rule_tags->len; i < n_rules; i++)
+    {
+      g_array_set_size (widget->rule_tags, i + 1);
+      g_array_index (widget->rule_tags, gint, i) = -1;
+    }
+
+  for (i = 0; i < n_rules; i++)
+    {
+      rule = g_ptr_array_index (rule_table, i);
+      tag = &g_array_index (widget->rule_tags, gint, i);
+
+      if (!highlight_urls || rule->disabled)
+        {
+          if (*tag != -1)
+            {
+              vte_terminal_match_remove (VTE_TERMINAL (widget), *tag);
+              *tag = -1;
+            }
+        }
+      else if (*tag == -1)
+        {
+          *tag = terminal_widget_match_add (widget, rule->regex);
+#if VTE_CHECK_VERSION (0, 53, 0)
+          if (rule->cursor != NULL)
+            vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), *tag, rule->cursor);
+#endif
+        }
+    }
+}
+
+
+
+static void
+terminal_widget_match_set_clickable (TerminalWidget *widget,
+                                     gint            tag,
+                                     gboolean        clickable)
+{
+#if VTE_CHECK_VERSION (0, 53, 0)
+  vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), tag, clickable ? "hand2" : "text");
+#else
+  vte_terminal_match_set_cursor_type (VTE_TERMINAL (widget), tag, clickable ? GDK_HAND2 : GDK_XTERM);
+#endif
+}
+
+
+
+static gint
+terminal_widget_match_add (TerminalWidget *widget,
+                           VteRegex       *regex)
+{
+  gint tag;
+
+  /* set the shared regular expression, vte takes a reference */
+  tag = vte_terminal_match_add_regex (VTE_TERMINAL (widget), regex, 0);
+  terminal_widget_match_set_clickable (widget, tag, TRUE);
+
+  return tag;
 }
 
 
@@ -721,18 +1782,39 @@ terminal_widget_open_uri (TerminalWidget *widget,
 static void
 terminal_widget_update_highlight_urls (TerminalWidget *widget)
 {
-  guint                       i;
-  gboolean                    highlight_urls;
-  VteRegex                   *regex;
-  const TerminalRegexPattern *pattern;
-  GError                     *error;
+  guint    i;
+  gboolean highlight_urls;
+  gboolean single_pass;
+  gchar   *rules;
+  guint    rule_limit;
 
   g_object_get (G_OBJECT (widget->preferences),
-                "misc-highlight-urls", &highlight_urls, NULL);
+                "misc-highlight-urls", &highlight_urls,
+                "misc-highlight-urls-single-pass", &single_pass,
+                "misc-match-rules", &rules,
+                "misc-match-rule-limit", &rule_limit,
+                NULL);
 
-  if (!highlight_urls)
+  if (widget->matching_suspended)
+    highlight_urls = FALSE;
+
+  /* the first widget to notice a change compiles the rules */
+  terminal_widget_rule_table_update (rules, rule_limit);
+  terminal_widget_update_rules (widget, highlight_urls);
+  g_free (rules);
+
+  /* the tags are about to change */
+  widget->hover_tag = -1;
+  widget->hover_missing_tag = -1;
+  widget->hover_column = widget->hover_row = -1;
+  g_free (widget->hover_match);
+  widget->hover_match = NULL;
+  g_free (widget->hover_path);
+  widget->hover_path = NULL;
+
+  /* remove the regex tags of the mode not in use */
+  if (!highlight_urls || single_pass)
     {
-      /* remove all our regex tags */
       for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
         if (widget->regex_tags[i] != -1)
           {
@@ -740,46 +1822,59 @@ terminal_widget_update_highlight_urls (TerminalWidget *widget)
             widget->regex_tags[i] = -1;
           }
     }
+  if ((!highlight_urls || !single_pass) && widget->regex_any_tag != -1)
+    {
+      vte_terminal_match_remove (VTE_TERMINAL (widget), widget->regex_any_tag);
+      widget->regex_any_tag = -1;
+    }
+
+  if (!highlight_urls)
+    return;
+
+  if (single_pass)
+    {
+      if (G_UNLIKELY (!regex_any_compiled))
+        terminal_widget_regex_any_compile ();
+
+      if (widget->regex_any_tag == -1 && regex_any != NULL)
+        widget->regex_any_tag = terminal_widget_match_add (widget, regex_any);
+    }
   else
     {
+      if (G_UNLIKELY (!regex_table_compiled))
+        terminal_widget_regex_table_compile ();
+
       /* set all our patterns */
       for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
         {
-          /* continue if already set */
-          if (G_UNLIKELY (widget->regex_tags[i] != -1))
+          /* continue if already set or failed to compile */
+          if (G_UNLIKELY (widget->regex_tags[i] != -1 || regex_table[i] == NULL))
             continue;
 
-          /* get the pattern */
-          pattern = &regex_patterns[i];
+          widget->regex_tags[i] = terminal_widget_match_add (widget, regex_table[i]);
+        }
+    }
+}
 
-          /* build the regex */
-          error = NULL;
-          regex = vte_regex_new_for_match (pattern->pattern, -1,
-                                           PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE,
-                                           &error);
 
-          if (error == NULL && (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &error) ||
-                                !vte_regex_jit (regex, PCRE2_JIT_PARTIAL_SOFT, &error)))
-            {
-              g_critical ("Failed to JIT regular expression '%s': %s\n", pattern->pattern, error->message);
-              g_clear_error (&error);
-            }
-          if (G_UNLIKELY (error != NULL))
-            {
-              g_critical ("Failed to parse regular expression pattern %d: %s", i, error->message);
-              g_error_free (error);
-              continue;
-            }
 
-          /* set the new regular expression */
-          widget->regex_tags[i] = vte_terminal_match_add_regex (VTE_TERMINAL (widget), regex, 0);
-#if VTE_CHECK_VERSION (0, 53, 0)
-          vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), widget->regex_tags[i], "hand2");
-#else
-          vte_terminal_match_set_cursor_type (VTE_TERMINAL (widget), widget->regex_tags[i], GDK_HAND2);
-#endif
-          /* release the regex owned by vte now */
-          vte_regex_unref (regex);
-        }
-    }
+/**
+ * terminal_widget_set_matching_suspended:
+ * @widget    : A #TerminalWidget.
+ * @suspended : Whether to suspend url matching.
+ *
+ * VTE checks the match under the pointer for every contents change,
+ * flooding terminals suspend the matching to avoid that.
+ **/
+void
+terminal_widget_set_matching_suspended (TerminalWidget *widget,
+                                        gboolean        suspended)
+{
+  terminal_return_if_fail (TERMINAL_IS_WIDGET (widget));
+
+  if (widget->matching_suspended == !!suspended)
+    return;
+
+  widget->matching_suspended = !!suspended;
+  terminal_widget_update_highlight_urls (widget);
 }
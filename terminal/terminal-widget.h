@@ -47,7 +47,10 @@ enum
 typedef struct _TerminalWidget      TerminalWidget;
 typedef struct _TerminalWidgetClass TerminalWidgetClass;
 
-GType      terminal_widget_get_type (void) G_GNUC_CONST;
+GType      terminal_widget_get_type               (void) G_GNUC_CONST;
+
+void       terminal_widget_set_matching_suspended (TerminalWidget *widget,
+                                                   gboolean        suspended);
 
 G_END_DECLS
 
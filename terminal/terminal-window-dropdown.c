@@ -38,6 +38,7 @@
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-window.h>
 #include <terminal/terminal-util.h>
+#include <terminal/terminal-timer.h>
 #include <terminal/terminal-window-dropdown.h>
 
 /* animation fps */
@@ -329,7 +330,7 @@ terminal_window_dropdown_finalize (GObject *object)
   TerminalWindowDropdown *dropdown = TERMINAL_WINDOW_DROPDOWN (object);
 
   if (dropdown->grab_timeout_id != 0)
-    g_source_remove (dropdown->grab_timeout_id);
+    terminal_timer_remove (dropdown->grab_timeout_id);
 
   if (dropdown->animation_timeout_id != 0)
     g_source_remove (dropdown->animation_timeout_id);
@@ -455,7 +456,7 @@ terminal_window_dropdown_focus_in_event (GtkWidget     *widget,
 
   /* stop a possible grab test */
   if (dropdown->grab_timeout_id != 0)
-    g_source_remove (dropdown->grab_timeout_id);
+    terminal_timer_remove (dropdown->grab_timeout_id);
 
   return (*GTK_WIDGET_CLASS (terminal_window_dropdown_parent_class)->focus_in_event) (widget, event);
 }
@@ -492,8 +493,9 @@ terminal_window_dropdown_focus_out_event (GtkWidget     *widget,
             {
               /* focus-out with keyboard grab */
               dropdown->grab_timeout_id =
-                  gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT_IDLE, 50, terminal_window_dropdown_can_grab,
-                                                dropdown, terminal_window_dropdown_can_grab_destroyed);
+                  terminal_timer_add (TERMINAL_WAKEUP_DROPDOWN_GRAB, TERMINAL_TIMER_TICK,
+                                      terminal_window_dropdown_can_grab,
+                                      dropdown, terminal_window_dropdown_can_grab_destroyed);
             }
         }
 
@@ -42,6 +42,7 @@
 #include <terminal/terminal-enum-types.h>
 #include <terminal/terminal-options.h>
 #include <terminal/terminal-preferences-dialog.h>
+#include <terminal/terminal-search-all-dialog.h>
 #include <terminal/terminal-search-dialog.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-marshal.h>
@@ -112,6 +113,12 @@ static void         terminal_window_style_set                     (GtkWidget
                                                                    GtkStyle            *previous_style);
 static gboolean     terminal_window_scroll_event                  (GtkWidget           *widget,
                                                                    GdkEventScroll      *event);
+static gboolean     terminal_window_zoom_tick                     (GtkWidget           *widget,
+                                                                   GdkFrameClock       *frame_clock,
+                                                                   gpointer             user_data);
+static gboolean     terminal_window_geometry_tick                 (GtkWidget           *widget,
+                                                                   GdkFrameClock       *frame_clock,
+                                                                   gpointer             user_data);
 static gboolean     terminal_window_map_event                     (GtkWidget           *widget,
                                                                    GdkEventAny         *event);
 static gboolean     terminal_window_focus_in_event                (GtkWidget           *widget,
@@ -166,6 +173,11 @@ static void         terminal_window_notebook_drag_data_received   (GtkWidget
                                                                    guint                info,
                                                                    guint                time,
                                                                    TerminalWindow      *window);
+static void         terminal_window_search_matches_changed        (TerminalScreen      *screen,
+                                                                   GParamSpec          *pspec,
+                                                                   TerminalWindow      *window);
+static void         terminal_window_search_index                  (TerminalWindow      *window,
+                                                                   gboolean             jump);
 static GtkNotebook *terminal_window_notebook_create_window        (GtkNotebook         *notebook,
                                                                    GtkWidget           *child,
                                                                    gint                 x,
@@ -247,6 +259,8 @@ static void         terminal_window_action_search_next            (GtkAction
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_search_prev            (GtkAction           *action,
                                                                    TerminalWindow      *window);
+static void         terminal_window_action_search_all             (GtkAction           *action,
+                                                                   TerminalWindow      *window);
 static void         terminal_window_action_save_contents          (GtkAction           *action,
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_reset                  (GtkAction           *action,
@@ -294,6 +308,7 @@ struct _TerminalWindowPrivate
   GtkActionGroup      *action_group;
 
   GtkWidget           *search_dialog;
+  GtkWidget           *search_all_dialog;
   GtkWidget           *title_popover;
 
   /* pushed size of screen */
@@ -326,10 +341,25 @@ struct _TerminalWindowPrivate
   TerminalVisibility   scrollbar_visibility;
   TerminalZoomLevel    zoom;
 
+  /* mouse wheel zoom steps applied on the next frame */
+  gint                 zoom_steps;
+  guint                zoom_tick_id;
+
+  /* last window size or geometry hints requested by a screen, applied
+   * on the next frame, and the number of size negotiations saved that way */
+  TerminalScreen      *geometry_screen;
+  glong                geometry_columns;
+  glong                geometry_rows;
+  guint                geometry_tick_id;
+  guint                geometry_avoided;
+  guint                geometry_resize : 1;
+
   GSList              *tab_key_accels;
 
   /* if this is a TerminalWindowDropdown */
   guint                drop_down : 1;
+
+  guint                iconified : 1;
 };
 
 static guint   window_signals[LAST_SIGNAL];
@@ -368,6 +398,7 @@ static const GtkActionEntry action_entries[] =
     { "search", "edit-find", N_ ("_Find..."), "<control><shift>f", N_ ("Search terminal contents"), G_CALLBACK (terminal_window_action_search), },
     { "search-next", NULL, N_ ("Find Ne_xt"), NULL, NULL, G_CALLBACK (terminal_window_action_search_next), },
     { "search-prev", NULL, N_ ("Find Pre_vious"), NULL, NULL, G_CALLBACK (terminal_window_action_search_prev), },
+    { "search-all", NULL, N_ ("Find in A_ll Tabs..."), NULL, N_ ("Search the contents of all terminals"), G_CALLBACK (terminal_window_action_search_all), },
     { "save-contents", "document-save-as", N_ ("Sa_ve Contents..."), NULL, NULL, G_CALLBACK (terminal_window_action_save_contents), },
     { "reset", NULL, N_ ("_Reset"), NULL, NULL, G_CALLBACK (terminal_window_action_reset), },
     { "reset-and-clear", NULL, N_ ("_Clear Scrollback and Reset"), NULL, NULL, G_CALLBACK (terminal_window_action_reset_and_clear), },
@@ -467,7 +498,9 @@ terminal_window_init (TerminalWindow *window)
   window->priv->zoom = TERMINAL_ZOOM_LEVEL_DEFAULT;
   window->priv->closed_tabs_list = g_queue_new ();
 
-  /* try to set the rgba colormap so vte can use real transparency */
+  /* try to set the rgba colormap so vte can use real transparency, an
+   * opaque background only skips the compositing of the screens, so
+   * the background can become translucent later */
   screen = gtk_window_get_screen (GTK_WINDOW (window));
   visual = gdk_screen_get_rgba_visual (screen);
   if (visual != NULL)
@@ -636,6 +669,13 @@ terminal_window_finalize (GObject *object)
   g_object_unref (G_OBJECT (window->priv->ui_manager));
   g_object_unref (G_OBJECT (window->priv->encoding_action));
 
+#ifdef G_ENABLE_DEBUG
+  g_debug ("Window avoided %u size negotiations", window->priv->geometry_avoided);
+#endif
+
+  if (window->priv->geometry_screen != NULL)
+    g_object_unref (G_OBJECT (window->priv->geometry_screen));
+
   g_slist_free (window->priv->tabs_menu_actions);
   g_free (window->priv->font);
   g_queue_free_full (window->priv->closed_tabs_list, (GDestroyNotify) terminal_tab_attr_free);
@@ -712,6 +752,14 @@ G_GNUC_END_IGNORE_DEPRECATIONS
         terminal_window_dropdown_update_geometry (TERMINAL_WINDOW_DROPDOWN (window));
   }
 
+  /* stop blinking and scrolling in the active screen of an iconified window */
+  if ((event->changed_mask & GDK_WINDOW_STATE_ICONIFIED) != 0)
+    {
+      window->priv->iconified = (event->new_window_state & GDK_WINDOW_STATE_ICONIFIED) != 0;
+      if (G_LIKELY (window->priv->active != NULL))
+        terminal_screen_set_hidden (window->priv->active, window->priv->iconified);
+    }
+
   if (GTK_WIDGET_CLASS (terminal_window_parent_class)->window_state_event != NULL)
     return (*GTK_WIDGET_CLASS (terminal_window_parent_class)->window_state_event) (widget, event);
 
@@ -748,18 +796,43 @@ terminal_window_scroll_event (GtkWidget      *widget,
   g_object_get (G_OBJECT (window->priv->preferences),
                 "misc-mouse-wheel-zoom", &mouse_wheel_zoom, NULL);
 
-  if (mouse_wheel_zoom && event->state == (GDK_SHIFT_MASK | GDK_CONTROL_MASK)
-      && event->direction == GDK_SCROLL_UP)
-    {
-      terminal_window_action_zoom_in (NULL, window);
-      return TRUE;
-    }
+  if (!mouse_wheel_zoom || event->state != (GDK_SHIFT_MASK | GDK_CONTROL_MASK))
+    return FALSE;
+
+  if (event->direction == GDK_SCROLL_UP)
+    window->priv->zoom_steps++;
+  else if (event->direction == GDK_SCROLL_DOWN)
+    window->priv->zoom_steps--;
+  else
+    return FALSE;
+
+  /* a fast wheel sends many steps per frame, only apply the sum */
+  if (window->priv->zoom_tick_id == 0)
+    window->priv->zoom_tick_id = gtk_widget_add_tick_callback (widget, terminal_window_zoom_tick, NULL, NULL);
+
+  return TRUE;
+}
 
-  if (mouse_wheel_zoom && event->state == (GDK_SHIFT_MASK | GDK_CONTROL_MASK)
-      && event->direction == GDK_SCROLL_DOWN)
+
+
+static gboolean
+terminal_window_zoom_tick (GtkWidget     *widget,
+                           GdkFrameClock *frame_clock,
+                           gpointer       user_data)
+{
+  TerminalWindow *window = TERMINAL_WINDOW (widget);
+  gint            zoom;
+
+  window->priv->zoom_tick_id = 0;
+
+  zoom = CLAMP ((gint) window->priv->zoom + window->priv->zoom_steps,
+                TERMINAL_ZOOM_LEVEL_MINIMUM, TERMINAL_ZOOM_LEVEL_MAXIMUM);
+  window->priv->zoom_steps = 0;
+
+  if (window->priv->active != NULL && (TerminalZoomLevel) zoom != window->priv->zoom)
     {
-      terminal_window_action_zoom_out (NULL, window);
-      return TRUE;
+      window->priv->zoom = zoom;
+      terminal_window_zoom_update_screens (window);
     }
 
   return FALSE;
@@ -1203,6 +1276,15 @@ terminal_window_notebook_page_switched (GtkNotebook     *notebook,
   /* only update when really changed */
   if (G_LIKELY (window->priv->active != active))
     {
+      /* the previous tab is no longer visible, unless it moved away */
+      if (window->priv->active != NULL
+          && gtk_widget_get_parent (GTK_WIDGET (window->priv->active)) == window->priv->notebook)
+        {
+          terminal_screen_set_hidden (window->priv->active, TRUE);
+        }
+      if (active != NULL)
+        terminal_screen_set_hidden (active, window->priv->iconified);
+
       /* store last and set new active tab */
       window->priv->last_active = window->priv->active;
       window->priv->active = active;
@@ -1216,6 +1298,16 @@ terminal_window_notebook_page_switched (GtkNotebook     *notebook,
       /* set charset for menu */
       encoding = terminal_screen_get_encoding (window->priv->active);
       terminal_encoding_action_set_charset (window->priv->encoding_action, encoding);
+
+      /* index the search of the open dialog in this tab too, a tab
+       * that was indexed before keeps its matches */
+      if (active != NULL)
+        {
+          if (window->priv->search_dialog != NULL
+              && gtk_widget_get_visible (window->priv->search_dialog))
+            terminal_window_search_index (window, FALSE);
+          terminal_window_search_matches_changed (active, NULL, window);
+        }
     }
 
   /* update actions in the window */
@@ -1272,10 +1364,17 @@ terminal_window_notebook_page_added (GtkNotebook    *notebook,
       G_CALLBACK (terminal_window_close_tab_request), window);
   g_signal_connect (G_OBJECT (screen), "drag-data-received",
       G_CALLBACK (terminal_window_notebook_drag_data_received), window);
+  g_signal_connect (G_OBJECT (screen), "notify::search-matches",
+      G_CALLBACK (terminal_window_search_matches_changed), window);
+  g_signal_connect (G_OBJECT (screen), "notify::search-match",
+      G_CALLBACK (terminal_window_search_matches_changed), window);
 
   /* release to the grid size applies */
   gtk_widget_realize (GTK_WIDGET (screen));
 
+  /* background tabs are hidden until switched to */
+  terminal_screen_set_hidden (screen, window->priv->iconified || screen != window->priv->active);
+
   /* match zoom and font */
   if (window->priv->font || window->priv->zoom != TERMINAL_ZOOM_LEVEL_DEFAULT)
     terminal_screen_update_font (screen);
@@ -1329,6 +1428,11 @@ terminal_window_notebook_page_removed (GtkNotebook    *notebook,
       terminal_window_close_tab_request, window);
   g_signal_handlers_disconnect_by_func (G_OBJECT (child),
       terminal_window_notebook_drag_data_received, window);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (child),
+      terminal_window_search_matches_changed, window);
+
+  /* the search dialog of this window no longer shows its matches */
+  terminal_screen_search_clear_matches (TERMINAL_SCREEN (child));
 
   /* set tab visibility */
   npages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook));
@@ -2367,12 +2471,37 @@ terminal_window_action_set_title_color (GtkAction      *action,
 
 
 
+static void
+terminal_window_search_index (TerminalWindow *window,
+                              gboolean        jump)
+{
+  VteRegex *regex;
+  GRegex   *scan_regex;
+  gboolean  wrap_around;
+
+  /* incomplete expressions are common while typing, no error dialog */
+  regex = terminal_search_dialog_get_regex (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), NULL);
+  scan_regex = terminal_search_dialog_get_scan_regex (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), NULL);
+  wrap_around = terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog));
+
+  terminal_screen_search_incremental (window->priv->active, regex, scan_regex, wrap_around, jump);
+
+  if (regex != NULL)
+    vte_regex_unref (regex);
+  if (scan_regex != NULL)
+    g_regex_unref (scan_regex);
+}
+
+
+
 static void
 terminal_window_action_search_response (GtkWidget      *dialog,
                                         gint            response_id,
                                         TerminalWindow *window)
 {
-  gboolean  can_search;
+  GtkWidget *page;
+  gboolean   can_search;
+  gint       n;
 
   terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
   terminal_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
@@ -2383,12 +2512,21 @@ terminal_window_action_search_response (GtkWidget      *dialog,
     terminal_window_action_search_next (NULL, window);
   else if (response_id == TERMINAL_RESPONSE_SEARCH_PREV)
     terminal_window_action_search_prev (NULL, window);
+  else if (response_id == TERMINAL_RESPONSE_SEARCH_CHANGED)
+    terminal_window_search_index (window, TRUE);
   else
     {
       /* need for hiding on focus */
       if (window->priv->drop_down)
         terminal_util_activate_window (GTK_WINDOW (window));
 
+      /* remove the highlights of all tabs, next and previous keep working */
+      for (n = 0; n < gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook)); n++)
+        {
+          page = gtk_notebook_get_nth_page (GTK_NOTEBOOK (window->priv->notebook), n);
+          terminal_screen_search_clear_matches (TERMINAL_SCREEN (page));
+        }
+
       /* hide dialog */
       window->priv->n_child_windows--;
       gtk_widget_hide (dialog);
@@ -2404,6 +2542,24 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 
+static void
+terminal_window_search_matches_changed (TerminalScreen *screen,
+                                        GParamSpec     *pspec,
+                                        TerminalWindow *window)
+{
+  gboolean indexed;
+  guint    current, total;
+
+  if (screen != window->priv->active || window->priv->search_dialog == NULL)
+    return;
+
+  indexed = terminal_screen_search_get_matches (screen, &current, &total);
+  terminal_search_dialog_set_matches (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog),
+                                      indexed, current, total);
+}
+
+
+
 static void
 terminal_window_action_search (GtkAction      *action,
                                TerminalWindow *window)
@@ -2473,6 +2629,42 @@ terminal_window_action_search_prev (GtkAction      *action,
 
 
 
+static void
+terminal_window_search_all_hidden (TerminalWindow *window)
+{
+  /* need for hiding on focus */
+  if (window->priv->drop_down && !gtk_widget_in_destruction (GTK_WIDGET (window)))
+    terminal_util_activate_window (GTK_WINDOW (window));
+
+  window->priv->n_child_windows--;
+}
+
+
+
+static void
+terminal_window_action_search_all (GtkAction      *action,
+                                   TerminalWindow *window)
+{
+  if (window->priv->search_all_dialog == NULL)
+    {
+      window->priv->search_all_dialog = terminal_search_all_dialog_new (GTK_WINDOW (window));
+      g_signal_connect (G_OBJECT (window->priv->search_all_dialog), "delete-event",
+          G_CALLBACK (gtk_widget_hide_on_delete), NULL);
+
+      /* the dialog hides itself when it is closed */
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_all_dialog), "hide",
+          G_CALLBACK (terminal_window_search_all_hidden), window);
+    }
+
+  /* increase child counter */
+  if (!gtk_widget_get_visible (window->priv->search_all_dialog))
+    window->priv->n_child_windows++;
+
+  terminal_search_all_dialog_present (TERMINAL_SEARCH_ALL_DIALOG (window->priv->search_all_dialog));
+}
+
+
+
 static void
 terminal_window_action_save_contents (GtkAction      *action,
                                       TerminalWindow *window)
@@ -2583,19 +2775,11 @@ terminal_window_action_about (GtkAction      *action,
 static void
 terminal_window_zoom_update_screens (TerminalWindow *window)
 {
-  gint            npages, n;
-  TerminalScreen *screen;
-  GtkAction      *action;
+  GtkAction *action;
 
   terminal_return_if_fail (GTK_IS_NOTEBOOK (window->priv->notebook));
 
-  /* walk the tabs */
-  npages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook));
-  for (n = 0; n < npages; n++)
-    {
-      screen = TERMINAL_SCREEN (gtk_notebook_get_nth_page (GTK_NOTEBOOK (window->priv->notebook), n));
-      terminal_screen_update_font (screen);
-    }
+  terminal_window_update_font (window);
 
   /* update zoom actions */
   action = terminal_window_get_action (window, "zoom-in");
@@ -3089,6 +3273,141 @@ terminal_window_set_font (TerminalWindow *window,
 
 
 
+static gboolean
+terminal_window_geometry_tick (GtkWidget     *widget,
+                               GdkFrameClock *frame_clock,
+                               gpointer       user_data)
+{
+  TerminalWindow *window = TERMINAL_WINDOW (widget);
+  TerminalScreen *screen = window->priv->geometry_screen;
+
+  window->priv->geometry_tick_id = 0;
+  window->priv->geometry_screen = NULL;
+
+  /* runs before the layout phase, so the new size is negotiated once */
+  if (G_LIKELY (screen != NULL))
+    {
+      if (gtk_widget_get_parent (GTK_WIDGET (screen)) == window->priv->notebook
+          && gtk_widget_get_realized (GTK_WIDGET (screen)))
+        {
+          if (window->priv->geometry_resize)
+            {
+              terminal_screen_apply_window_size (screen, GTK_WINDOW (window),
+                                                 window->priv->geometry_columns,
+                                                 window->priv->geometry_rows);
+            }
+          else
+            terminal_screen_apply_window_geometry_hints (screen, GTK_WINDOW (window));
+        }
+      g_object_unref (G_OBJECT (screen));
+    }
+
+  return FALSE;
+}
+
+
+
+/**
+ * terminal_window_queue_geometry:
+ * @window  : A #TerminalWindow.
+ * @screen  : The #TerminalScreen the size is based on.
+ * @columns : Number of columns or 0 for the current size.
+ * @rows    : Number of rows or 0 for the current size.
+ *
+ * Queues the geometry hints and size of @window for the next frame.
+ * Font updates, zooming and adding tabs often request a size several
+ * times in a row, only the last request is applied.
+ **/
+void
+terminal_window_queue_geometry (TerminalWindow *window,
+                                TerminalScreen *screen,
+                                glong           columns,
+                                glong           rows)
+{
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (window->priv->geometry_screen != NULL)
+    {
+      window->priv->geometry_avoided++;
+      g_object_unref (G_OBJECT (window->priv->geometry_screen));
+    }
+
+  window->priv->geometry_screen = g_object_ref (G_OBJECT (screen));
+  window->priv->geometry_columns = columns;
+  window->priv->geometry_rows = rows;
+  window->priv->geometry_resize = TRUE;
+
+  if (window->priv->geometry_tick_id == 0)
+    {
+      window->priv->geometry_tick_id =
+          gtk_widget_add_tick_callback (GTK_WIDGET (window), terminal_window_geometry_tick, NULL, NULL);
+    }
+}
+
+
+
+/**
+ * terminal_window_queue_geometry_hints:
+ * @window : A #TerminalWindow.
+ * @screen : The #TerminalScreen the hints are based on.
+ *
+ * Queues the geometry hints of @window for the next frame, without
+ * resizing it. A resize queued in the same frame sets the hints too,
+ * so it is kept.
+ **/
+void
+terminal_window_queue_geometry_hints (TerminalWindow *window,
+                                      TerminalScreen *screen)
+{
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (window->priv->geometry_screen != NULL)
+    {
+      window->priv->geometry_avoided++;
+      if (window->priv->geometry_resize)
+        return;
+      g_object_unref (G_OBJECT (window->priv->geometry_screen));
+    }
+
+  window->priv->geometry_screen = g_object_ref (G_OBJECT (screen));
+  window->priv->geometry_resize = FALSE;
+
+  if (window->priv->geometry_tick_id == 0)
+    {
+      window->priv->geometry_tick_id =
+          gtk_widget_add_tick_callback (GTK_WIDGET (window), terminal_window_geometry_tick, NULL, NULL);
+    }
+}
+
+
+
+/**
+ * terminal_window_update_font:
+ * @window  : A #TerminalWindow.
+ *
+ * Applies the font and zoom level to all the tabs of @window. Only the
+ * visible tab is updated right away, see terminal_screen_update_font().
+ **/
+void
+terminal_window_update_font (TerminalWindow *window)
+{
+  gint            npages, n;
+  TerminalScreen *screen;
+
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+
+  npages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook));
+  for (n = 0; n < npages; n++)
+    {
+      screen = TERMINAL_SCREEN (gtk_notebook_get_nth_page (GTK_NOTEBOOK (window->priv->notebook), n));
+      terminal_screen_update_font (screen);
+    }
+}
+
+
+
 /**
  * terminal_window_get_scrollbar_visibility:
  * @window  : A #TerminalWindow.
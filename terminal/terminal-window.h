@@ -90,6 +90,14 @@ GtkAction         *terminal_window_get_action               (TerminalWindow
 const gchar       *terminal_window_get_font                 (TerminalWindow     *window);
 void               terminal_window_set_font                 (TerminalWindow     *window,
                                                              const gchar        *font);
+void               terminal_window_update_font              (TerminalWindow     *window);
+
+void               terminal_window_queue_geometry           (TerminalWindow     *window,
+                                                             TerminalScreen     *screen,
+                                                             glong               columns,
+                                                             glong               rows);
+void               terminal_window_queue_geometry_hints     (TerminalWindow     *window,
+                                                             TerminalScreen     *screen);
 
 TerminalVisibility terminal_window_get_scrollbar_visibility (TerminalWindow     *window);
 void               terminal_window_set_scrollbar_visibility (TerminalWindow     *window,